@@ -188,7 +188,7 @@ void widget_group::clear() {
 
 bool widget_group::operator() ( element_context& context ) {
     for( auto& c : conditions ) {
-        auto& cfn = std::get< any_condition_fn >( context.s.functions[ c ] );
+        auto& cfn = std::get< any_condition_fn >( context.s.functions.at( c ) );
         if( !cfn.fn( context ) ) return false;
     }
     return true;
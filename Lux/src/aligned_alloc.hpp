@@ -0,0 +1,35 @@
+// Allocator for std::vector storage aligned to a cache line, so SIMD loops can rely on aligned starts
+
+#ifndef __ALIGNED_ALLOC_HPP
+#define __ALIGNED_ALLOC_HPP
+
+#include <cstddef>
+#include <new>
+#include <numeric>
+#include <vector>
+
+static constexpr size_t cache_line = 64;
+
+template< class T, size_t A = cache_line > struct aligned_allocator {
+    typedef T value_type;
+    template< class U > struct rebind { typedef aligned_allocator< U, A > other; };
+
+    aligned_allocator() noexcept {}
+    template< class U > aligned_allocator( const aligned_allocator< U, A >& ) noexcept {}
+
+    T* allocate( size_t n ) { return static_cast< T* >( ::operator new( n * sizeof( T ), std::align_val_t( A ) ) ); }
+    void deallocate( T* p, size_t n ) noexcept { ::operator delete( p, n * sizeof( T ), std::align_val_t( A ) ); }
+
+    template< class U > bool operator == ( const aligned_allocator< U, A >& ) const noexcept { return true; }
+    template< class U > bool operator != ( const aligned_allocator< U, A >& ) const noexcept { return false; }
+};
+
+template< class T > using aligned_vector = std::vector< T, aligned_allocator< T > >;
+
+// smallest element count whose size is a whole number of cache lines - 16 for a 12 byte frgb
+template< class T > constexpr size_t aligned_count() { return cache_line / std::gcd( cache_line, sizeof( T ) ); }
+
+// n rounded up so the next block of T starts on a cache line
+template< class T > constexpr size_t aligned_round( size_t n ) { return ( n + aligned_count< T >() - 1 ) / aligned_count< T >() * aligned_count< T >(); }
+
+#endif // __ALIGNED_ALLOC_HPP
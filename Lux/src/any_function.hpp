@@ -13,12 +13,12 @@ template < class T > struct any_fn {};
     _T_##_fn fn; \
     std::string name; \
     _T_ operator () ( _T_& val, element_context& context ) { return fn( val, context ); } \
-    any_fn< _T_ >() : name("identity_" #_T_ "_default") { \
+    any_fn() : name("identity_" #_T_ "_default") { \
         std::shared_ptr< identity_##_T_ > f( new identity_fn< _T_ > ); \
         fn = std::ref( *f ); \
         any_fn_ptr = f; \
     } \
-    any_fn< _T_ >( any_##_T_##_fn_ptr any_##_T_##_fn, _T_##_fn fn, std::string name ) : any_fn_ptr( any_##_T_##_fn ), fn( fn ), name( name ) {}; \
+    any_fn( any_##_T_##_fn_ptr any_##_T_##_fn, _T_##_fn fn, std::string name ) : any_fn_ptr( any_##_T_##_fn ), fn( fn ), name( name ) {}; \
 };
 
 typedef std::variant < 
@@ -51,4 +51,11 @@ template< class T > void copy_buffer( T& to, const any_buffer_pair_ptr& from ) {
 	to->copy_first( *f ); 
 }
 
+// copy on write version of copy_buffer - see buffer_pair::borrow()
+template< class T > void borrow_buffer( T& to, const any_buffer_pair_ptr& from ) { 
+	const T& f = std::get< T >( from );
+	if( f.get() == NULL ) throw std::runtime_error( "borrow_buffer(): attempt to borrow null buffer" );
+	to->borrow( *f ); 
+}
+
 #endif // __ANY_IMAGE_HPP
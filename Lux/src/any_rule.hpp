@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
 #include "ucolor.hpp"
 
 typedef enum CA_hood  {  HOOD_MOORE, 
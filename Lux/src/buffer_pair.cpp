@@ -1,4 +1,7 @@
 #include "buffer_pair.hpp"
+#include "fimage.hpp"
+#include "uimage.hpp"
+#include <algorithm>
 
 template< class T > buffer_pair< T >::buffer_pair() {
     image_pair.first = NULL;
@@ -29,7 +32,60 @@ template< class T > buffer_pair< T >::buffer_pair( const buffer_pair< T >& bp )
 }
 */
 
-template< class T > bool buffer_pair< T >::has_image() {
+template< class T > buffer_pair< T >::~buffer_pair() { 
+    detach();
+    unborrow();
+    release(); 
+}
+
+template< class T > void buffer_pair< T >::set_pool( const std::shared_ptr< image_pool< T > >& p ) { pool = p; }
+
+template< class T > void buffer_pair< T >::set_pool( image_pools& pools ) { pool = pools.get< T >(); }
+
+template< class T > void buffer_pair< T >::release() {
+    if( pool ) {
+        pool->give( image_pair.first );
+        pool->give( image_pair.second );
+    }
+    image_pair.first.reset( NULL );
+    image_pair.second.reset( NULL );
+}
+
+// any first image kept while borrowing is reused here, so a list borrowing every frame copies into the same memory
+template< class T > void buffer_pair< T >::own() {
+    if( source == NULL ) return;
+    const image< T >& img = source->read_image();
+    if( image_pair.first.get() != NULL ) image_pair.first->copy( img );
+    else if( pool ) image_pair.first = pool->take( img );
+    else image_pair.first = std::make_unique< image< T > >( img );
+    unborrow();
+}
+
+template< class T > void buffer_pair< T >::detach() {
+    // own() removes each borrower from the list
+    for( ;; ) {
+        buffer_pair< T >* b;
+        {
+            std::lock_guard< std::mutex > guard( borrow_lock );
+            if( borrowers.empty() ) return;
+            b = borrowers.back();
+        }
+        b->own();
+    }
+}
+
+template< class T > void buffer_pair< T >::unborrow() {
+    if( source == NULL ) return;
+    {
+        std::lock_guard< std::mutex > guard( source->borrow_lock );
+        auto& b = source->borrowers;
+        b.erase( std::remove( b.begin(), b.end(), this ), b.end() );
+    }
+    source = NULL;
+}
+
+template< class T > bool buffer_pair< T >::has_image() const {
+    if( source != NULL ) return source->has_image();
     return image_pair.first.get() != NULL;
 }
 
@@ -37,64 +93,108 @@ template< class T > bool buffer_pair< T >::is_swapped() {
     return swapped;
 }
 
+template< class T > bool buffer_pair< T >::is_borrowed() const {
+    return source != NULL;
+}
+
 template< class T > image< T >& buffer_pair< T >::get_image() {
+    detach();
+    own();
     return *image_pair.first;
 }
 
 template< class T > const image< T >& buffer_pair< T >::get_image() const {
+    return read_image();
+}
+
+template< class T > const image< T >& buffer_pair< T >::read_image() const {
+    if( source != NULL ) return source->read_image();
     return *image_pair.first;
 }
 
 template< class T > std::unique_ptr< image< T > >& buffer_pair< T >::get_image_ptr() { 
+    detach();
+    own();
     return image_pair.first; 
 }
 
 template< class T > image< T >& buffer_pair< T >::get_buffer() {
-    if( image_pair.second.get() == NULL ) image_pair.second.reset( new image< T >( *image_pair.first ) );
-    return *image_pair.second;
+    return *get_buffer_ptr();
 }
 
 template< class T > std::unique_ptr< image< T > >& buffer_pair< T >::get_buffer_ptr() { 
-    if( image_pair.second.get() == NULL ) image_pair.second.reset( new image< T >( *image_pair.first ) );
+    if( image_pair.second.get() == NULL ) {
+        if( pool ) image_pair.second = pool->take( read_image() );
+        else image_pair.second.reset( new image< T >( read_image() ) );
+    }
     return image_pair.second; 
 }
 
+// A borrowing pair stops borrowing here without copying - the buffer becomes its image,
+// and the image it kept while borrowing becomes the next buffer
 template< class T > void buffer_pair< T >::swap() { 
+    detach();
+    unborrow();
     image_pair.first.swap( image_pair.second ); 
     swapped = !swapped;
 }
 
 template< class T > void buffer_pair< T >::reset( const image< T >& img ) { 
-    image_pair.first.reset( new image< T >( img ) );
-    image_pair.second.reset( NULL );
+    // img may be one of ours, so copy it before handing anything back
+    image_ptr copy = pool ? pool->take( img ) : std::make_unique< image< T > >( img );
+    detach();
+    unborrow();
+    release();
+    image_pair.first = std::move( copy );
     swapped = false;
 }
 
 template< class T > void buffer_pair< T >::reset( vec2i& dim ) { 
-    image_pair.first.reset( new image< T >( dim ) );
-    image_pair.second.reset( NULL );
+    detach();
+    unborrow();
+    release();
+    if( pool ) image_pair.first = pool->take( dim );
+    else image_pair.first.reset( new image< T >( dim ) );
     swapped = false;
 }
 
 template< class T > void buffer_pair< T >::copy_first( const buffer_pair<T>& bp ) { 
     //std::cout << "buffer_pair::copy_first()" << std::endl;
-    if( bp.image_pair.first.get()  != NULL ) {
+    detach();
+    unborrow();
+    if( bp.has_image() ) {
         //std::cout << "buffer_pair::copy_first() - source pointer not NULL" << std::endl;
         if( image_pair.first.get() == NULL ) {
             //std::cout << "buffer_pair::copy_first() - dest pointer NULL" << std::endl;
-            image_pair.first = std::make_unique< image< T > >( *bp.image_pair.first );
+            if( pool ) image_pair.first = pool->take( bp.read_image() );
+            else image_pair.first = std::make_unique< image< T > >( bp.read_image() );
         }
         else {
             //std::cout << "buffer_pair::copy_first() - dest pointer not NULL" << std::endl;
-            image_pair.first->copy( *bp.image_pair.first );
+            image_pair.first->copy( bp.read_image() );
         }
     }
     else {
         //std::cout << "buffer_pair::copy_first() - source pointer NULL" << std::endl;
+        if( pool ) pool->give( image_pair.first );
         image_pair.first.reset( NULL );
     }
 }
 
+template< class T > void buffer_pair< T >::borrow( buffer_pair<T>& bp ) { 
+    if( &bp == this ) return;
+    detach();
+    unborrow();
+    if( !bp.has_image() ) { copy_first( bp ); return; }
+    // borrowing from a borrower means reading what it reads
+    buffer_pair< T >* root = &bp;
+    while( root->source != NULL ) root = root->source;
+    if( root == this ) return;
+    source = root;
+    std::lock_guard< std::mutex > guard( root->borrow_lock );
+    root->borrowers.push_back( this );
+}
+
 template< class T > image< T >& buffer_pair< T >::operator () () {
     return get_buffer();
 }
@@ -2,26 +2,45 @@
 #define __BUFFER_PAIR_HPP
 
 #include "image.hpp"
+#include "image_pool.hpp"
+#include <mutex>
 
 // Used for double-buffered rendering. Owns pointer to image - makes a duplicate when 
 // double-buffering is needed for an effect. Can be used in effect lists or for 
 // persistent effects such as CA, melt, or hyperspace
+// With a pool set, images are borrowed from it and handed back on reset or destruction instead of freed.
+// A pair can also borrow another pair's image (copy on write) - reads see the source directly and a private
+// copy is only made when something writes, or when the source itself is about to change.
 
 template< class T > class buffer_pair {
     typedef std::unique_ptr< image< T > > image_ptr;
     std::pair< image_ptr, image_ptr > image_pair;
     bool swapped = false;
+    std::shared_ptr< image_pool< T > > pool;
+    void release();                             // hand both images back to the pool (or free them)
+    buffer_pair< T >* source = NULL;            // pair whose image we read until the first write
+    std::vector< buffer_pair< T >* > borrowers; // pairs reading our image
+    std::mutex borrow_lock;                     // guards borrowers - lists rendered in parallel may share a source
+    void own();                                 // replace borrowed image with a private copy
+    void detach();                              // give borrowers their own copies before our image changes
+    void unborrow();                            // stop reading source
 public:
     buffer_pair();
     buffer_pair( const std::string& filename );
     buffer_pair( const image< T >& img );       // copy image into buffer
     buffer_pair( vec2i& dim );                  // create empty buffer of given dimensions
 //  buffer_pair( const buffer_pair< T >& bp );  // copy constructor
+    ~buffer_pair();
 
-    bool has_image();
+    void set_pool( const std::shared_ptr< image_pool< T > >& p );  // borrow images from p from now on
+    void set_pool( image_pools& pools );                           // the pool for this pixel type
+
+    bool has_image() const;
     bool is_swapped();
-    image< T >& get_image();
+    bool is_borrowed() const;
+    image< T >& get_image();                    // for writing - copies a borrowed image first
     const image< T >& get_image() const;
+    const image< T >& read_image() const;       // for reading - never copies
     std::unique_ptr< image< T > >& get_image_ptr();
     image< T >& get_buffer();                   // get buffer, create if necessary
     std::unique_ptr< image< T > >& get_buffer_ptr();
@@ -56,6 +75,8 @@ public:
 
     //copy first image
     void copy_first( const buffer_pair<T>& bp );
+    // share first image of bp until one of us writes
+    void borrow( buffer_pair<T>& bp );
 
     image< T >& operator () ();
 };
@@ -103,7 +103,7 @@ template< class T > void eff_mirror< T >::operator () ( any_buffer_pair_ptr& buf
     {
         auto& buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >(buf);
         if( !buf_ptr->has_image() ) throw std::runtime_error( "eff_mirror: no image in buffer" );
-        buf_ptr->get_buffer().mirror( buf_ptr->get_image(), reflect_x, reflect_y, top_to_bottom, left_to_right, *center, extend );
+        buf_ptr->get_buffer().mirror( buf_ptr->read_image(), reflect_x, reflect_y, top_to_bottom, left_to_right, *center, extend );
         buf_ptr->swap();
     }
 }
@@ -119,7 +119,7 @@ template< class T > void eff_turn< T >::operator () ( any_buffer_pair_ptr& buf,
     {
         auto& buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >(buf);
         if( !buf_ptr->has_image() ) throw std::runtime_error( "eff_turn: no image in buffer" );
-        buf_ptr->get_buffer().turn( buf_ptr->get_image(), direction );
+        buf_ptr->get_buffer().turn( buf_ptr->read_image(), direction );
         buf_ptr->swap();
     }
 }
@@ -135,7 +135,7 @@ template< class T > void eff_flip< T >::operator () ( any_buffer_pair_ptr& buf,
     {
         auto& buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >(buf);
         if( !buf_ptr->has_image() ) throw std::runtime_error( "eff_flip: no image in buffer" );
-        buf_ptr->get_buffer().flip( buf_ptr->get_image(), flip_x, flip_y );
+        buf_ptr->get_buffer().flip( buf_ptr->read_image(), flip_x, flip_y );
         buf_ptr->swap();
     }
 } 
@@ -151,9 +151,11 @@ template< class T > void eff_vector_warp< T >::operator () ( any_buffer_pair_ptr
     {
         auto& buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >(buf);
         if( !buf_ptr->has_image() ) throw std::runtime_error( "eff_vector_warp: no image in buffer" );
-        any_buffer_pair_ptr vf_buf = context.s.buffers[ vf_name ];
-        auto& vf = std::get< vbuf_ptr >( vf_buf )->get_image();   // extract vector field from buffer variant
-        buf_ptr->get_buffer().warp( buf_ptr->get_image(), vf, *step, smooth, relative, extend );
+        auto vf_it = context.s.buffers.find( vf_name );
+        if( vf_it == context.s.buffers.end() ) throw std::runtime_error( "eff_vector_warp: vector field " + vf_name + " not found" );
+        any_buffer_pair_ptr vf_buf = vf_it->second;
+        auto& vf = std::get< vbuf_ptr >( vf_buf )->read_image();   // extract vector field from buffer variant
+        buf_ptr->get_buffer().warp( buf_ptr->read_image(), vf, *step, smooth, relative, extend );
         buf_ptr->swap();
     }
 }
@@ -170,9 +172,11 @@ template< class T > void eff_feedback< T >::operator () ( any_buffer_pair_ptr& b
     {
         auto& buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >(buf);
         if( !buf_ptr->has_image() ) throw std::runtime_error( "eff_feedback: no image in buffer" );
-        any_buffer_pair_ptr wf_buf = context.s.buffers[ wf_name ];
-        auto& wf = std::get< wbuf_ptr >( wf_buf )->get_image();  // extract warp field from buffer variant
-        buf_ptr->get_image().warp( buf_ptr->get_image(), wf );
+        auto wf_it = context.s.buffers.find( wf_name );
+        if( wf_it == context.s.buffers.end() ) throw std::runtime_error( "eff_feedback: warp field " + wf_name + " not found" );
+        any_buffer_pair_ptr wf_buf = wf_it->second;
+        auto& wf = std::get< wbuf_ptr >( wf_buf )->read_image();  // extract warp field from buffer variant
+        buf_ptr->get_buffer().warp( buf_ptr->read_image(), wf );
         buf_ptr->swap();
     }
 }
@@ -336,9 +340,26 @@ template< class T > void eff_turbulent< T >::operator () ( any_buffer_pair_ptr&
     if (std::holds_alternative< vbuf_ptr>(buf)) 
     {
         auto& buf_ptr = std::get< vbuf_ptr >(buf);
-        vf_tools tools( buf_ptr->get_image() );
+        n( context ); bounds( context ); scale_factor( context );
+        min_diameter( context ); max_diameter( context ); min_soften( context ); max_soften( context );
+        min_intensity( context ); max_intensity( context ); min_velocity( context ); max_velocity( context );
+        min_orbital_radius( context ); max_orbital_radius( context );
         vortex_field v( *n, revolving, *scale_factor, *min_diameter, *max_diameter, *min_soften, *max_soften, *min_intensity, *max_intensity, intensity_direction, *min_velocity, *max_velocity, velocity_direction, *min_orbital_radius, *max_orbital_radius );
-        tools.turbulent( v );
+        v.bounds = *bounds;
+        if( !field.generated || !field.same_parameters( v ) ) {
+            field = v;
+            field.generate();
+            fields.clear();
+        }
+        if( cache ) {
+            fields.set_phases( cache_phases );
+            fields.set_max_bytes( (size_t)cache_mb << 20 );
+            fields.render( buf_ptr->get_image(), field, context.s.time, context.s.time_interval );
+        }
+        else {
+            vf_tools tools( buf_ptr->get_image() );
+            tools.turbulent( field, context.s.time );
+        }
     }
 }
 
@@ -356,6 +356,14 @@ template< class T > struct eff_turbulent {
     rotation_direction velocity_direction;   // object of RotationDirection
     harness< float > min_orbital_radius, max_orbital_radius; // float
 
+    // Animated fields loop - with cache on, the field for each phase of the loop is kept ( see turbulent_cache )
+    bool cache;
+    int cache_phases;                   // steps per loop, 0 for one per frame
+    int cache_mb;                       // memory for kept fields
+
+    vortex_field field;                 // generated on first use and again when parameters change
+    turbulent_cache fields;
+
     void operator () ( any_buffer_pair_ptr& buf, element_context& context );
 
     eff_turbulent( int n_init = 10, bool revolving_init = true ) : 
@@ -373,7 +381,10 @@ template< class T > struct eff_turbulent {
         max_velocity( 1 ), 
         velocity_direction( RANDOM ),
         min_orbital_radius( 0.0f ), 
-        max_orbital_radius( 0.5f )  {}
+        max_orbital_radius( 0.5f ),
+        cache( false ),
+        cache_phases( 0 ),
+        cache_mb( 256 )  {}
 };
 
 typedef eff_turbulent< vec2f > eff_turbulent_vec2f;
@@ -3,95 +3,97 @@
 #include "fimage.hpp"
 #include <memory>
 #include "image_loader.hpp"
+#include "thread_pool.hpp"
+#include "frgb_batch.hpp"
 
 // pixel modification functions
 
 template<> void fimage::clamp( float minc, float maxc ) {
     for( auto& c : base ) { linalg::clamp( c, minc, maxc ); }
-    //mip_it();
+    mark_dirty();
 }
 
 template<> void fimage::constrain() {
     for( auto& c : base ) { ::constrain( c ); }
-    //mip_it();
+    mark_dirty();
 }
 
 template<> void fimage::grayscale() {
     for( auto& c : base ) { c = gray( c ); }
-    //mip_it();
+    mark_dirty();
 }
 
 template<> void fimage::invert() {
     for( auto& c : base ) { ::invert( c ); }
-    //mip_it();
+    mark_dirty();
 }
 
 template<> void fimage::rotate_colors( const int& r ) {
     for( auto& c : base ) { rotate_color( c, r ); }
-    //mip_it();
+    mark_dirty();
 }
 
+// Rows are converted in parallel through the sRGB to linear table, three channel rows in one batch. Alpha is dropped,
+// and grey images set every channel
 template<> void fimage::load( const std::string& filename ) {
-    //std::cout << "fimage::load " << filename << std::endl;
     reset();
     image_loader loader( filename );
     dim = { loader.xsiz, loader.ysiz };
     refresh_bounds();
-	int c = 0;
-    frgb f;
-
-    for (auto it = std::begin (loader.img); it <= std::end (loader.img); ) {
-        if( loader.channels == 1 )	// monochrome image
-        {
-            setrc( f, *it );
-            setgc( f, *it );
-            setbc( f, *it );
-            it++;
-        }
-
-        if( loader.channels == 2 ) // don't know what to do in this case
-        {
-            setrc( f, *it );
-            setgc( f, *it );
-            setbc( f, *it );
-            it++; it++;
+    base.resize( (size_t)dim.x * dim.y );
+    const unsigned char* in = loader.img.data();
+    int channels = loader.channels;
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        frgb* out = base.data();
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        if( channels == 3 ) SRGB_to_linear_n( (float*)( out + i0 ), in + i0 * 3, ( i1 - i0 ) * 3 );
+        else for( size_t i = i0; i < i1; i++ ) {
+            const unsigned char* p = in + i * channels;
+            out[ i ] = channels == 4 ? fsetc( p[ 0 ], p[ 1 ], p[ 2 ] ) : fsetc( p[ 0 ], p[ 0 ], p[ 0 ] );
         }
+    } );
+    mark_dirty();
+}
 
-        if( loader.channels == 4 ) 	it++;   // argb format
+// three bytes per pixel for the encoder, converted in parallel rows
+static std::vector< unsigned char > encode_bytes( const frgb* base, const vec2i& dim ) {
+    std::vector< unsigned char > img( (size_t)dim.x * dim.y * 3 );
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        linear_to_SRGB_n( img.data() + i0 * 3, (const float*)( base + i0 ), ( i1 - i0 ) * 3 );
+    } );
+    return img;
+}
 
-        if( ( loader.channels == 3 ) | ( loader.channels == 4 ) )
-        {
-            setrc( f, *it );
-            it++;
-            setgc( f, *it );
-            it++;
-            setbc( f, *it );
-            it++;
-        }
+void to_uimage( image< ucolor >& out, const fimage& in, const gamma_LUT& lut ) {
+    vec2i dim = in.get_dim();
+    out.set_dim( dim );
+    out.set_bounds( in.get_bounds() );
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        frgb_to_ucolor_n( out.get_base() + i0, in.get_base() + i0, i1 - i0, lut );
+    } );
+    out.mark_dirty();
+}
 
-        base.push_back( f );
-    }
-    //mip_it();
-    //std::cout << "Image load complete\n";
+void to_fimage( fimage& out, const image< ucolor >& in, const gamma_LUT& lut ) {
+    vec2i dim = in.get_dim();
+    out.set_dim( dim );
+    out.set_bounds( in.get_bounds() );
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        ucolor_to_frgb_n( out.get_base() + i0, in.get_base() + i0, i1 - i0, lut );
+    } );
+    out.mark_dirty();
 }
 
 template<> void fimage::write_jpg( const std::string& filename, int quality ) {
-    std::vector< unsigned char > img;
-    for( auto& f : base ) {
-        img.push_back( rc( f ) );
-        img.push_back( gc( f ) );
-        img.push_back( bc( f ) ); 
-    }
+    std::vector< unsigned char > img = encode_bytes( base.data(), dim );
     wrapped_write_jpg( filename.c_str(), dim.x, dim.y, 3, img.data(), quality );
 }
 
 template<> void fimage::write_png( const std::string& filename ) {    
-    std::vector< unsigned char > img;
-    for( auto& f : base ) {
-        img.push_back( rc( f ) );
-        img.push_back( gc( f ) );
-        img.push_back( bc( f ) ); 
-    }
+    std::vector< unsigned char > img = encode_bytes( base.data(), dim );
 	wrapped_write_png( filename.c_str(), dim.x, dim.y, 3, img.data() );
 }
 
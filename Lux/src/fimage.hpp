@@ -4,6 +4,7 @@
 #define __FIMAGE_HPP
 
 #include "image.hpp"
+#include "gamma_lut.hpp"
 
 #define fimage image< frgb >
 
@@ -19,4 +20,8 @@ template<> void fimage::load( const std::string& filename );
 template<> void fimage::write_jpg( const std :: string& filename, int quality );
 template<> void fimage::write_png( const std :: string& filename );
 
+// conversions to and from uimage through lut, in parallel rows - out takes the size and bounds of in
+void to_uimage( image< ucolor >& out, const fimage& in, const gamma_LUT& lut = srgb_gamma() );
+void to_fimage( fimage& out, const image< ucolor >& in, const gamma_LUT& lut = srgb_gamma() );
+
 #endif // __FIMAGE_HPP
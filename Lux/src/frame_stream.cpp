@@ -0,0 +1,70 @@
+#include "frame_stream.hpp"
+#include "image_loader.hpp"
+#include <stdexcept>
+
+static bool ends_with( const std::string& filename, const std::string& ext ) {
+    return filename.size() >= ext.size() && filename.compare( filename.size() - ext.size(), ext.size(), ext ) == 0;
+}
+
+bool is_stream_name( const std::string& filename ) {
+    if( filename == "-" ) return true;
+    for( std::string ext : { ".y4m", ".rgba", ".raw", ".pngs" } ) if( ends_with( filename, ext ) ) return true;
+    return false;
+}
+
+stream_format stream_format_for( const std::string& filename ) {
+    if( ends_with( filename, ".rgba" ) || ends_with( filename, ".raw" ) ) return STREAM_RGBA;
+    if( ends_with( filename, ".pngs" ) ) return STREAM_PNG;
+    return STREAM_Y4M;
+}
+
+frame_stream::frame_stream( const std::string& filename, stream_format format_init, int fps_init ) 
+    : format( format_init ), fps( fps_init ), dim( 0, 0 ), frames( 0 ) 
+{
+    owned = filename != "-";
+    out = owned ? fopen( filename.c_str(), "wb" ) : stdout;
+    if( out == NULL ) throw std::runtime_error( "frame_stream: could not open " + filename );
+}
+
+frame_stream::~frame_stream() {
+    if( owned ) fclose( out );
+    else fflush( out );
+}
+
+// BT.601 studio range, the default for Y4M readers
+static inline void rgb_to_yuv( const ucolor& c, unsigned char& y, unsigned char& u, unsigned char& v ) {
+    int r = rc( c ), g = gc( c ), b = bc( c );
+    y = (unsigned char)( ( (  66 * r + 129 * g +  25 * b + 128 ) >> 8 ) +  16 );
+    u = (unsigned char)( ( ( -38 * r -  74 * g + 112 * b + 128 ) >> 8 ) + 128 );
+    v = (unsigned char)( ( ( 112 * r -  94 * g -  18 * b + 128 ) >> 8 ) + 128 );
+}
+
+void frame_stream::write( const image< ucolor >& img ) {
+    vec2i d = img.get_dim();
+    if( frames == 0 ) {
+        dim = d;
+        if( format == STREAM_Y4M ) fprintf( out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", dim.x, dim.y, fps );
+    }
+    else if( d != dim ) throw std::runtime_error( "frame_stream: frame dimensions changed" );
+
+    size_t n = (size_t)dim.x * dim.y;
+    const ucolor* p = img.get_base();
+    if( format == STREAM_Y4M ) {
+        // planar - all of Y, then U, then V
+        bytes.resize( n * 3 );
+        for( size_t i = 0; i < n; i++ ) rgb_to_yuv( p[ i ], bytes[ i ], bytes[ n + i ], bytes[ 2 * n + i ] );
+        fputs( "FRAME\n", out );
+    }
+    else {
+        bytes.resize( n * 4 );
+        for( size_t i = 0; i < n; i++ ) {
+            bytes[ i * 4     ] = rc( p[ i ] );
+            bytes[ i * 4 + 1 ] = gc( p[ i ] );
+            bytes[ i * 4 + 2 ] = bc( p[ i ] );
+            bytes[ i * 4 + 3 ] = ac( p[ i ] );
+        }
+    }
+    if( format == STREAM_PNG ) wrapped_write_png( out, dim.x, dim.y, 4, bytes.data() );
+    else if( fwrite( bytes.data(), 1, bytes.size(), out ) != bytes.size() ) throw std::runtime_error( "frame_stream: write failed" );
+    frames++;
+}
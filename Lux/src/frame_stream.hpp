@@ -0,0 +1,51 @@
+// Streams animation frames into a single file, or to stdout, so an encoder can read them as they are rendered
+// instead of compressing a JPEG per frame and reading the files back afterwards
+//
+//   STREAM_RGBA  raw 8-bit RGBA, no header         ffmpeg -f rawvideo -pix_fmt rgba -s 512x512 -r 30 -i frames.rgba
+//   STREAM_Y4M   YUV4MPEG2 4:4:4, self-describing  ffmpeg -i frames.y4m  (or: lux scene.json - 100 | ffmpeg -i - out.mp4)
+//   STREAM_PNG   PNG frames back to back           ffmpeg -f image2pipe -c:v png -i frames.pngs
+//
+// The PNG stream is the lossless archival form - every frame is a complete PNG, compressed on its own
+
+#ifndef __FRAME_STREAM_HPP
+#define __FRAME_STREAM_HPP
+
+#include "image.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+typedef enum stream_format
+{
+    STREAM_RGBA,
+    STREAM_Y4M,
+    STREAM_PNG
+} stream_format;
+
+// true for "-" and names ending .y4m, .rgba, .raw or .pngs - output that lux streams rather than writing as images
+bool is_stream_name( const std::string& filename );
+
+// format named by extension - .rgba or .raw, .y4m, .pngs. Anything else, including "-" for stdout, is Y4M
+stream_format stream_format_for( const std::string& filename );
+
+class frame_stream {
+    FILE* out;
+    bool owned;             // false when writing to stdout
+    stream_format format;
+    int fps;
+    vec2i dim;              // set by first frame
+    int frames;
+    std::vector< unsigned char > bytes;    // one converted frame
+
+public:
+    frame_stream( const std::string& filename, stream_format format_init = STREAM_Y4M, int fps_init = 30 ); // "-" writes to stdout
+    ~frame_stream();
+
+    frame_stream( const frame_stream& ) = delete;
+    frame_stream& operator = ( const frame_stream& ) = delete;
+
+    void write( const image< ucolor >& img );  // later frames must match the dimensions of the first
+    int size() const { return frames; }
+};
+
+#endif // __FRAME_STREAM_HPP
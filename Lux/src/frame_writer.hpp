@@ -0,0 +1,111 @@
+// Background threads for encoding and writing finished frames while later ones render
+// submit() blocks once max_pending frames are queued or being written, so memory stays bounded
+// Each frame carries its own filename, so they can finish in any order. Web builds write on the calling thread
+
+#ifndef __FRAME_WRITER_HPP
+#define __FRAME_WRITER_HPP
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+class frame_writer {
+#ifndef __EMSCRIPTEN__
+    std::vector< std::thread > workers;
+    std::deque< std::function< void () > > jobs;
+    std::mutex m;
+    std::condition_variable job_cv;     // signalled when a job is queued or writer is stopping
+    std::condition_variable done_cv;    // signalled when a job finishes
+    size_t pending = 0;                 // jobs queued or running
+    size_t max_pending;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void work() {
+        for( ;; ) {
+            std::function< void () > job;
+            {
+                std::unique_lock< std::mutex > lock( m );
+                job_cv.wait( lock, [ this ] { return stopping || !jobs.empty(); } );
+                if( jobs.empty() ) return;
+                job = std::move( jobs.front() );
+                jobs.pop_front();
+            }
+            std::exception_ptr e;
+            try { job(); }
+            catch( ... ) { e = std::current_exception(); }
+            {
+                std::lock_guard< std::mutex > lock( m );
+                if( e && !error ) error = e;
+                pending--;
+            }
+            done_cv.notify_all();
+        }
+    }
+
+    // first exception thrown by a job is rethrown on the submitting thread
+    void rethrow() {
+        if( error ) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception( e );
+        }
+    }
+#endif // __EMSCRIPTEN__
+
+public:
+    // queues job, waiting for room if max_pending jobs are already queued or running
+    void submit( std::function< void () > job ) {
+#ifndef __EMSCRIPTEN__
+        if( workers.size() ) {
+            {
+                std::unique_lock< std::mutex > lock( m );
+                done_cv.wait( lock, [ this ] { return pending < max_pending || error; } );
+                rethrow();
+                jobs.push_back( std::move( job ) );
+                pending++;
+            }
+            job_cv.notify_one();
+            return;
+        }
+#endif // __EMSCRIPTEN__
+        job();
+    }
+
+    // waits for every queued job to finish
+    void finish() {
+#ifndef __EMSCRIPTEN__
+        std::unique_lock< std::mutex > lock( m );
+        done_cv.wait( lock, [ this ] { return pending == 0; } );
+        rethrow();
+#endif // __EMSCRIPTEN__
+    }
+
+#ifndef __EMSCRIPTEN__
+    // no threads writes each frame inside submit()
+    frame_writer( unsigned int nthreads = 1, unsigned int max_pending_init = 2 ) : max_pending( std::max( max_pending_init, 1u ) ) {
+        for( unsigned int i = 0; i < nthreads; i++ ) workers.emplace_back( [ this ] { work(); } );
+    }
+
+    // lets queued jobs finish - call finish() first to see their errors
+    ~frame_writer() {
+        {
+            std::lock_guard< std::mutex > lock( m );
+            stopping = true;
+        }
+        job_cv.notify_all();
+        for( auto& w : workers ) w.join();
+    }
+#else
+    frame_writer( unsigned int nthreads = 1, unsigned int max_pending_init = 2 ) {}
+#endif // __EMSCRIPTEN__
+};
+
+#endif // __FRAME_WRITER_HPP
@@ -4,17 +4,15 @@
 #include "frgb.hpp"
 #include "gamma_lut.hpp"
 
-static gamma_LUT glut( 2.2f );
-
 float rf( const frgb &c )       { return c.R; }
 float gf( const frgb &c )       { return c.G; }
 float bf( const frgb &c )       { return c.B; }
 
 // returns single bytes per component - assumes [0.0, 1.0] range
 // clip or constrain out of range values before using
-unsigned char rc( const frgb &c ) {  return (unsigned char)glut.linear_to_SRGB( c.R ); }
-unsigned char gc( const frgb &c ) {  return (unsigned char)glut.linear_to_SRGB( c.G ); }
-unsigned char bc( const frgb &c ) {  return (unsigned char)glut.linear_to_SRGB( c.B ); }
+unsigned char rc( const frgb &c ) {  return (unsigned char)srgb_gamma().linear_to_SRGB( c.R ); }
+unsigned char gc( const frgb &c ) {  return (unsigned char)srgb_gamma().linear_to_SRGB( c.G ); }
+unsigned char bc( const frgb &c ) {  return (unsigned char)srgb_gamma().linear_to_SRGB( c.B ); }
 
 // unsigned int ul() {} // bit shifty stuff
 
@@ -27,24 +25,24 @@ frgb setf(  const float& r, const float& g, const float& b ) { return { r, g, b
 
 // TODO - set from bracketed list
 
-void setrc( frgb &c, const unsigned char& r ) { c.R = glut.SRGB_to_linear( r ); }
-void setgc( frgb &c, const unsigned char& g ) { c.G = glut.SRGB_to_linear( g ); }
-void setbc( frgb &c, const unsigned char& b ) { c.B = glut.SRGB_to_linear( b ); }
+void setrc( frgb &c, const unsigned char& r ) { c.R = srgb_gamma().SRGB_to_linear( r ); }
+void setgc( frgb &c, const unsigned char& g ) { c.G = srgb_gamma().SRGB_to_linear( g ); }
+void setbc( frgb &c, const unsigned char& b ) { c.B = srgb_gamma().SRGB_to_linear( b ); }
 void setc(  frgb &c, const unsigned char& r, const unsigned char& g, const unsigned char& b ) 
 { setrc( c, r );   setgc( c, g );   setbc( c, b ); }
 frgb fsetc( const unsigned char& r, const unsigned char& g, const unsigned char& b )
-{ return { glut.SRGB_to_linear( r ), glut.SRGB_to_linear( g ), glut.SRGB_to_linear( b ) }; }
+{ return { srgb_gamma().SRGB_to_linear( r ), srgb_gamma().SRGB_to_linear( g ), srgb_gamma().SRGB_to_linear( b ) }; }
 
 void setu( frgb &c, const unsigned int& u ) {
-    c.R = glut.SRGB_to_linear( (unsigned char)( ( u & 0x00ff0000 ) >> 16 ) );
-    c.G = glut.SRGB_to_linear( (unsigned char)( ( u & 0x0000ff00 ) >> 8 ) );
-    c.B = glut.SRGB_to_linear( (unsigned char)(   u & 0x000000ff ) );
+    c.R = srgb_gamma().SRGB_to_linear( (unsigned char)( ( u & 0x00ff0000 ) >> 16 ) );
+    c.G = srgb_gamma().SRGB_to_linear( (unsigned char)( ( u & 0x0000ff00 ) >> 8 ) );
+    c.B = srgb_gamma().SRGB_to_linear( (unsigned char)(   u & 0x000000ff ) );
 }
 
 frgb fsetu( const unsigned int& u ) {
-    return { glut.SRGB_to_linear( (unsigned char)( ( u & 0x00ff0000 ) >> 16 ) ),
-             glut.SRGB_to_linear( (unsigned char)( ( u & 0x0000ff00 ) >> 8 ) ),
-             glut.SRGB_to_linear( (unsigned char)(   u & 0x000000ff ) ) };
+    return { srgb_gamma().SRGB_to_linear( (unsigned char)( ( u & 0x00ff0000 ) >> 16 ) ),
+             srgb_gamma().SRGB_to_linear( (unsigned char)( ( u & 0x0000ff00 ) >> 8 ) ),
+             srgb_gamma().SRGB_to_linear( (unsigned char)(   u & 0x000000ff ) ) };
 }
 
 //void setul( unsigned int in ) {} // bit shifty stuff
@@ -0,0 +1,39 @@
+// Batch conversions between frgb and 8 bit sRGB
+// Pixel conversions go through a small byte buffer, one cache-sized block at a time, so the table kernels do all the work
+
+#include "frgb_batch.hpp"
+#include "ucolor_batch.hpp"
+#include <algorithm>
+
+static constexpr size_t block = 256;   // pixels per block in pixel conversions
+
+static bool use_avx2() { return get_isa() == ISA_AVX2 && avx2_linear_to_SRGB(); }
+
+void linear_to_SRGB_n( unsigned char* out, const float* in, size_t n, const gamma_LUT& lut ) {
+    size_t i = use_avx2() ? avx2_linear_to_SRGB()( out, in, n, lut.linear_to_SRGB_table() ) : 0;
+    for( ; i < n; i++ ) out[ i ] = lut.linear_to_SRGB( in[ i ] );
+}
+
+void SRGB_to_linear_n( float* out, const unsigned char* in, size_t n, const gamma_LUT& lut ) {
+    size_t i = use_avx2() ? avx2_SRGB_to_linear()( out, in, n, lut.SRGB_to_linear_table() ) : 0;
+    for( ; i < n; i++ ) out[ i ] = lut.SRGB_to_linear( in[ i ] );
+}
+
+void frgb_to_ucolor_n( ucolor* out, const frgb* in, size_t n, const gamma_LUT& lut ) {
+    unsigned char rgb[ block * 3 ];
+    for( size_t b = 0; b < n; b += block ) {
+        size_t m = std::min( block, n - b );
+        linear_to_SRGB_n( rgb, (const float*)( in + b ), m * 3, lut );
+        for( size_t i = 0; i < m; i++ )
+            out[ b + i ] = 0xff000000 | ( (ucolor)rgb[ i * 3 ] << 16 ) | ( (ucolor)rgb[ i * 3 + 1 ] << 8 ) | rgb[ i * 3 + 2 ];
+    }
+}
+
+void ucolor_to_frgb_n( frgb* out, const ucolor* in, size_t n, const gamma_LUT& lut ) {
+    unsigned char rgb[ block * 3 ];
+    for( size_t b = 0; b < n; b += block ) {
+        size_t m = std::min( block, n - b );
+        unpack_rgb_n( rgb, in + b, m );
+        SRGB_to_linear_n( (float*)( out + b ), rgb, m * 3, lut );
+    }
+}
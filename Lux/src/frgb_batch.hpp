@@ -0,0 +1,28 @@
+// Batch conversions between linear floating point color and 8 bit sRGB, through the tables of a gamma_LUT
+// With get_isa() at ISA_AVX2 the table lookups are gathers, eight values at a time. Every instruction set gives
+// exactly the result of the single value functions - gamma_LUT::linear_to_SRGB() and gamma_LUT::SRGB_to_linear()
+
+#ifndef __FRGB_BATCH_HPP
+#define __FRGB_BATCH_HPP
+
+#include "frgb.hpp"
+#include "ucolor.hpp"
+#include "gamma_lut.hpp"
+#include <cstddef>
+
+// n values each way - an frgb run is 3 * n floats in R, G, B order
+void linear_to_SRGB_n( unsigned char* out, const float* in, size_t n, const gamma_LUT& lut = srgb_gamma() );
+void SRGB_to_linear_n( float* out, const unsigned char* in, size_t n, const gamma_LUT& lut = srgb_gamma() );
+
+// n pixels - as setf( ucolor&, r, g, b ) with alpha opaque, and as setu( frgb&, u ) with alpha dropped
+void frgb_to_ucolor_n( ucolor* out, const frgb* in, size_t n, const gamma_LUT& lut = srgb_gamma() );
+void ucolor_to_frgb_n( frgb* out, const ucolor* in, size_t n, const gamma_LUT& lut = srgb_gamma() );
+
+// Kernels from frgb_batch_avx2.cpp, internal to frgb_batch.cpp - null unless it was compiled for AVX2
+// Each takes the table of the direction it converts and returns the number of values done
+typedef size_t ( *linear_to_SRGB_kernel )( unsigned char*, const float*, size_t, const int* );
+typedef size_t ( *SRGB_to_linear_kernel )( float*, const unsigned char*, size_t, const float* );
+linear_to_SRGB_kernel avx2_linear_to_SRGB();
+SRGB_to_linear_kernel avx2_SRGB_to_linear();
+
+#endif // __FRGB_BATCH_HPP
@@ -0,0 +1,51 @@
+// AVX2 versions of the frgb batch kernels
+// Built with -mavx2 on x86 (see CMakeLists.txt) and only called after a runtime check, so nothing else lives here
+
+#include "frgb_batch.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// Same cases as gamma_LUT::linear_to_SRGB() - in range values index the table by low exponent and high mantissa bits,
+// the rest are 0, 1 or 255. The eight results are gathered as words and narrowed to bytes with a shuffle and a permute
+static size_t linear_to_SRGB_avx2( unsigned char* out, const float* in, size_t n, const int* table ) {
+    const __m256 tiny = _mm256_set1_ps( 0.000032f ), one = _mm256_set1_ps( 1.0f ), zero = _mm256_setzero_ps();
+    const __m256i bits = _mm256_set1_epi32( 0x07ff8000 );
+    const __m256i narrow = _mm256_setr_epi8( 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                             0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+    const __m256i join = _mm256_setr_epi32( 0, 4, 1, 1, 1, 1, 1, 1 );
+    size_t i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        __m256 x = _mm256_loadu_ps( in + i );
+        __m256 low  = _mm256_cmp_ps( x, tiny, _CMP_LT_OQ );
+        __m256 high = _mm256_cmp_ps( x, one,  _CMP_GE_OQ );
+        __m256 mid  = _mm256_and_ps( _mm256_cmp_ps( x, tiny, _CMP_GE_OQ ), _mm256_cmp_ps( x, one, _CMP_LT_OQ ) );
+        __m256i index = _mm256_srli_epi32( _mm256_and_si256( _mm256_castps_si256( x ), bits ), 15 );
+        __m256i v = _mm256_mask_i32gather_epi32( _mm256_setzero_si256(), table, index, _mm256_castps_si256( mid ), 4 );
+        __m256i small = _mm256_castps_si256( _mm256_and_ps( low, _mm256_cmp_ps( x, zero, _CMP_GT_OQ ) ) );
+        v = _mm256_or_si256( v, _mm256_and_si256( small, _mm256_set1_epi32( 1 ) ) );
+        v = _mm256_or_si256( v, _mm256_and_si256( _mm256_castps_si256( high ), _mm256_set1_epi32( 0xff ) ) );
+        v = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( v, narrow ), join );
+        _mm_storel_epi64( (__m128i*)( out + i ), _mm256_castsi256_si128( v ) );
+    }
+    return i;
+}
+
+static size_t SRGB_to_linear_avx2( float* out, const unsigned char* in, size_t n, const float* table ) {
+    size_t i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        __m256i index = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)( in + i ) ) );
+        _mm256_storeu_ps( out + i, _mm256_i32gather_ps( table, index, 4 ) );
+    }
+    return i;
+}
+
+linear_to_SRGB_kernel avx2_linear_to_SRGB() { return linear_to_SRGB_avx2; }
+SRGB_to_linear_kernel avx2_SRGB_to_linear() { return SRGB_to_linear_avx2; }
+
+#else
+
+linear_to_SRGB_kernel avx2_linear_to_SRGB() { return nullptr; }
+SRGB_to_linear_kernel avx2_SRGB_to_linear() { return nullptr; }
+
+#endif // __AVX2__
@@ -63,22 +63,28 @@ gamma_LUT :: gamma_LUT( float gamma ) {
   flubber flub;
   for ( unsigned int i=0; i < lts_entries; i++ ) {
     flub.ui = 0x38000000 | ( i << lts_shift );                        // 0 | 01110000 | 00000000000000000000000  (black magic)
-    linear_to_SRGB_LUT[i] = (unsigned char)( powf( flub.f, 1.0f / 2.2f ) * 255 );
+    linear_to_SRGB_LUT[i] = (unsigned char)( powf( flub.f, 1.0f / gamma ) * 255 );
+    linear_to_SRGB_wide[i] = linear_to_SRGB_LUT[i];
   }
 } 
 
-float gamma_LUT :: SRGB_to_linear(unsigned char index) { return SRGB_to_linear_LUT[ index ]; }
+float gamma_LUT :: SRGB_to_linear(unsigned char index) const { return SRGB_to_linear_LUT[ index ]; }
 
 // may be more efficient to do reinterpret_cast on array of pointers to float
-unsigned char gamma_LUT :: linear_to_SRGB( float index ) {
+unsigned char gamma_LUT :: linear_to_SRGB( float index ) const {
   // Cases for table underflow (SRGB value less than two) and overflow
   if( index < 0.000032f ) {
     if( index <= 0.0f ) return 0x00;
     else return 1;
   }
-  if( index >= 1.0 ) return 0xff;
+  if( !( index < 1.0f ) ) return index >= 1.0f ? 0xff : 0x00;  // NaN is black rather than a read past the table
 
   flubber flub;
   flub.f = index;
   return linear_to_SRGB_LUT[ ( flub.ui & 0x07ff8000 ) >> lts_shift ];  // 0 | 00001111 | 11111111000000000000000 (black magic)
 }
+
+const gamma_LUT& srgb_gamma() {
+  static gamma_LUT lut( 2.2f );
+  return lut;
+}
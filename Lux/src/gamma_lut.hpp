@@ -16,12 +16,21 @@ class gamma_LUT {
     float gamma;
     std::array< float, 256 > SRGB_to_linear_LUT;
     std::array< unsigned char, lts_entries >  linear_to_SRGB_LUT;
+    std::array< int, lts_entries >  linear_to_SRGB_wide;    // same table a word per entry, for gathers
 
 public:
     gamma_LUT( float gamma );
 
-    float SRGB_to_linear( unsigned char index );
-    unsigned char linear_to_SRGB( float index );
+    float get_gamma() const { return gamma; }
+    float SRGB_to_linear( unsigned char index ) const;
+    unsigned char linear_to_SRGB( float index ) const;
+
+    // tables for the batch kernels in frgb_batch.cpp
+    const float* SRGB_to_linear_table() const { return SRGB_to_linear_LUT.data(); }
+    const int* linear_to_SRGB_table() const { return linear_to_SRGB_wide.data(); }
 };
 
+// Shared 2.2 table behind rc(), setrc() and the other single value conversions in frgb.cpp and ucolor.cpp
+const gamma_LUT& srgb_gamma();
+
 #endif // __GAMMA_LUT_HPP
@@ -0,0 +1,152 @@
+#include "frgb_batch.hpp"
+#include "ucolor_batch.hpp"
+#include "joy_rand.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <functional>
+
+// Checks the frgb batch conversions against the single value functions for each instruction set this machine supports,
+// reports how far the tables are from exact gamma curves, then times each conversion.
+// Usage: ./gamma_test [pixels] [repeats]
+
+// values that hit every case of linear_to_SRGB(), then random ones spread over the table
+std::vector< float > test_floats( size_t n ) {
+    std::vector< float > v = { 0.0f, -0.0f, -1.0f, 0.000031f, 0.000032f, 0.000033f, 0.5f, 0.99999f, 1.0f, 1.5f,
+        std::numeric_limits< float >::denorm_min(), std::numeric_limits< float >::infinity(), -std::numeric_limits< float >::infinity(),
+        std::numeric_limits< float >::quiet_NaN() };
+    while( v.size() < n ) {
+        float x = rand1( gen );
+        v.push_back( x * x * x * 1.2f - 0.05f );
+    }
+    v.resize( n );
+    return v;
+}
+
+std::vector< unsigned char > test_bytes( size_t n ) {
+    std::vector< unsigned char > v( n );
+    for( size_t i = 0; i < n; i++ ) v[ i ] = i < 256 ? i : rand_uint( gen ) & 0xff;
+    return v;
+}
+
+// every conversion against a loop of single value calls, over run lengths that exercise the leftovers
+bool check( const gamma_LUT& lut ) {
+    bool ok = true;
+    for( size_t n : { 0, 1, 7, 8, 9, 15, 16, 17, 31, 100, 257, 1000, 100003 } ) {
+        auto f = test_floats( n );
+        std::vector< unsigned char > b1( n ), b2( n );
+        linear_to_SRGB_n( b1.data(), f.data(), n, lut );
+        for( size_t i = 0; i < n; i++ ) b2[ i ] = lut.linear_to_SRGB( f[ i ] );
+        for( size_t i = 0; i < n; i++ ) if( b1[ i ] != b2[ i ] ) {
+            std::cout << "  linear_to_SRGB mismatch at " << i << " of " << n << ": " << f[ i ] << " -> " << (int)b1[ i ] << " expected " << (int)b2[ i ] << std::endl;
+            ok = false;
+            break;
+        }
+
+        auto b = test_bytes( n );
+        std::vector< float > f1( n ), f2( n );
+        SRGB_to_linear_n( f1.data(), b.data(), n, lut );
+        for( size_t i = 0; i < n; i++ ) f2[ i ] = lut.SRGB_to_linear( b[ i ] );
+        for( size_t i = 0; i < n; i++ ) if( f1[ i ] != f2[ i ] ) {
+            std::cout << "  SRGB_to_linear mismatch at " << i << " of " << n << ": " << (int)b[ i ] << " -> " << f1[ i ] << " expected " << f2[ i ] << std::endl;
+            ok = false;
+            break;
+        }
+
+        // whole pixels, as setf() and setu() would convert them with this table
+        std::vector< frgb > px( n ), px1( n );
+        for( size_t i = 0; i < n; i++ ) px[ i ] = { f[ i ], f[ ( i * 7 ) % n ], f[ ( i * 13 ) % n ] };
+        std::vector< ucolor > u1( n ), u2( n );
+        frgb_to_ucolor_n( u1.data(), px.data(), n, lut );
+        for( size_t i = 0; i < n; i++ ) u2[ i ] = 0xff000000 | ( lut.linear_to_SRGB( px[ i ].R ) << 16 ) | ( lut.linear_to_SRGB( px[ i ].G ) << 8 ) | lut.linear_to_SRGB( px[ i ].B );
+        ucolor_to_frgb_n( px1.data(), u2.data(), n, lut );
+        for( size_t i = 0; i < n; i++ ) {
+            frgb expected = { lut.SRGB_to_linear( rc( u2[ i ] ) ), lut.SRGB_to_linear( gc( u2[ i ] ) ), lut.SRGB_to_linear( bc( u2[ i ] ) ) };
+            if( u1[ i ] != u2[ i ] || px1[ i ] != expected ) {
+                std::cout << "  pixel conversion mismatch at " << i << " of " << n << std::hex << ": " << u1[ i ] << " expected " << u2[ i ] << std::dec << std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+// largest difference in 8 bit steps between the table and round( pow( x, 1 / gamma ) * 255 ), over a fine sweep of [ 0, 1 ]
+// the table truncates, so up to one step is expected
+void accuracy( const gamma_LUT& lut ) {
+    float g = lut.get_gamma();
+    int worst = 0;
+    float worst_x = 0.0f;
+    for( int i = 0; i <= 1 << 20; i++ ) {
+        float x = (float)i / ( 1 << 20 );
+        int exact = (int)std::lround( std::pow( x, 1.0f / g ) * 255.0f );
+        int d = std::abs( exact - (int)lut.linear_to_SRGB( x ) );
+        if( d > worst ) { worst = d; worst_x = x; }
+    }
+    float worst_f = 0.0f;
+    for( int i = 0; i < 256; i++ ) worst_f = std::max( worst_f, std::abs( lut.SRGB_to_linear( i ) - std::pow( i / 255.0f, g ) ) );
+    std::cout << "gamma " << g << ": to sRGB within " << worst << " step" << ( worst == 1 ? "" : "s" ) << " ( worst at " << worst_x << " )"
+              << ", to linear within " << worst_f << std::endl;
+}
+
+int main( int argc, char** argv ) {
+    size_t pixels = 1 << 20;
+    int repeats = 20;
+    if( argc > 1 ) std::stringstream( argv[ 1 ] ) >> pixels;
+    if( argc > 2 ) std::stringstream( argv[ 2 ] ) >> repeats;
+
+    std::vector< ucolor_isa > isas;
+    for( ucolor_isa isa : { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_NEON } ) {
+        set_isa( isa );
+        if( get_isa() == isa ) isas.push_back( isa );
+    }
+
+    bool ok = true;
+    std::vector< float > gammas = { 2.2f, 1.8f, 2.4f, 1.0f };
+    for( auto isa : isas ) {
+        set_isa( isa );
+        bool passed = true;
+        for( float g : gammas ) passed &= check( gamma_LUT( g ) );
+        std::cout << std::left << std::setw( 8 ) << isa_name( isa ) << ( passed ? "matches scalar" : "FAILED" ) << std::endl;
+        ok &= passed;
+    }
+    std::cout << std::endl;
+    for( float g : gammas ) accuracy( gamma_LUT( g ) );
+
+    // timing in ms per run of pixels
+    typedef std::chrono::steady_clock clock;
+    auto f = test_floats( pixels * 3 );
+    auto b = test_bytes( pixels * 3 );
+    std::vector< frgb > px( pixels );
+    std::vector< ucolor > u( pixels );
+    std::vector< unsigned char > bo( pixels * 3 );
+    std::vector< float > fo( pixels * 3 );
+    std::vector< std::pair< std::string, std::function< void () > > > ops = {
+        { "linear_to_SRGB", [ & ] { linear_to_SRGB_n( bo.data(), f.data(), pixels * 3 ); } },
+        { "SRGB_to_linear", [ & ] { SRGB_to_linear_n( fo.data(), b.data(), pixels * 3 ); } },
+        { "frgb_to_ucolor", [ & ] { frgb_to_ucolor_n( u.data(), (const frgb*)f.data(), pixels ); } },
+        { "ucolor_to_frgb", [ & ] { ucolor_to_frgb_n( px.data(), u.data(), pixels ); } },
+        { "rc / gc / bc",   [ & ] { const frgb* p = (const frgb*)f.data(); for( size_t i = 0; i < pixels; i++ ) { bo[ i * 3 ] = rc( p[ i ] ); bo[ i * 3 + 1 ] = gc( p[ i ] ); bo[ i * 3 + 2 ] = bc( p[ i ] ); } } }
+    };
+    std::cout << std::endl << pixels << " pixels" << std::endl << std::left << std::setw( 16 ) << "";
+    for( auto isa : isas ) std::cout << std::right << std::setw( 10 ) << isa_name( isa );
+    std::cout << std::endl;
+    for( auto& op : ops ) {
+        std::cout << std::left << std::setw( 16 ) << op.first;
+        for( auto isa : isas ) {
+            set_isa( isa );
+            auto t0 = clock::now();
+            for( int i = 0; i < repeats; i++ ) op.second();
+            auto t1 = clock::now();
+            std::cout << std::right << std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << std::chrono::duration< double, std::milli >( t1 - t0 ).count() / repeats;
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+    set_isa( best_isa() );
+    return ok ? 0 : 1;
+}
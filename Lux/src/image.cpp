@@ -3,219 +3,375 @@
 // Supports linear interpolated sampling and mip-mapping - multiple resolutions for anti-aliasing
 
 #include "image.hpp"
+#include "image_file.hpp"
 #include "fimage.hpp"
 #include "uimage.hpp"
 #include "vector_field.hpp"
 #include "warp_field.hpp"
 #include "any_image.hpp"
+#include "ucolor_batch.hpp"
+#include "thread_pool.hpp"
 #include <iostream>
 #include <fstream>
-
-template< class T > inline T blend4( const T& a, const T& b, const T& c, const T& d ) {
-    return ( a + b + c + d ) / 4;
+#include <array>
+
+// Mip-map pyramid
+// Each level halves the one below, rounding up. Kernels are separable: box [ 1 1 ], tent [ 1 2 1 ] and gaussian [ 1 4 6 4 1 ]
+// centered on the even pixels below. Taps that fall outside the level below are dropped and the rest renormalized.
+// Levels are built mip_pass_levels at a time in bands of rows - a band pulls each row it needs up through the levels,
+// so several levels come out of one pass over the pixels below while those rows are still in cache. Rows a band needs
+// from its neighbors are worked out again in the band's own scratch, so bands run in parallel without sharing anything.
+// After small edits only the footprint of each changed rectangle is rebuilt, one level at a time (see mark_dirty()).
+
+template< mip_kernel K > struct mip_taps;
+template<> struct mip_taps< MIP_BOX >      { static constexpr int first =  0, n = 2, sum =  2; static constexpr int w[ 2 ] = { 1, 1 }; };
+template<> struct mip_taps< MIP_TENT >     { static constexpr int first = -1, n = 3, sum =  4; static constexpr int w[ 3 ] = { 1, 2, 1 }; };
+template<> struct mip_taps< MIP_GAUSSIAN > { static constexpr int first = -2, n = 5, sum = 16; static constexpr int w[ 5 ] = { 1, 4, 6, 4, 1 }; };
+
+static constexpr int mip_pass_levels = 4;
+static constexpr int mip_ring = 8;     // rows kept per level - must hold the widest kernel
+
+// output pixels [ x0, x1 ) have every tap inside a row of below_width pixels
+template< class K > static void mip_interior( int width, int below_width, int& x0, int& x1 ) {
+    x0 = std::min( ( 1 - K::first ) / 2, width );
+    int last = below_width - K::first - K::n;    // 2 * x must not pass this
+    x1 = last < 0 ? x0 : std::clamp( last / 2 + 1, x0, width );
 }
 
-template<> inline ucolor blend4( const ucolor& a, const ucolor& b, const ucolor& c, const ucolor& d ) {
-    return blend(a, b, c, d);
-}
+// divide by total weight - floating point types multiply by the reciprocal
+template< class T > static inline T mip_divide( const T& sum, const int& wt ) { return sum / wt; }
+template<> inline frgb  mip_divide( const frgb&  sum, const int& wt ) { return sum * ( 1.0f / wt ); }
+template<> inline vec2f mip_divide( const vec2f& sum, const int& wt ) { return sum * ( 1.0f / wt ); }
+
+// Weighted sums down, then across. Generic version adds up pixels with integer weights, then divides.
+template< class T > struct mip_sums {
+    std::vector< T > v;     // one row of vertical sums
+
+    void resize( int width ) { v.resize( width ); }
+
+    // columns [ c0, c1 ) of the rows below
+    void vertical( const T* const* rows, const int* w, int n, int c0, int c1 ) {
+        if constexpr( std::is_same_v< T, frgb > || std::is_same_v< T, vec2f > ) {
+            // as a run of floats, so the loops vectorize
+            constexpr int c = sizeof( T ) / sizeof( float );
+            int i0 = c0 * c, i1 = c1 * c;
+            float* out = (float*)v.data();
+            const float* r = (const float*)rows[ 0 ];
+            float w0 = w[ 0 ];
+            for( int i = i0; i < i1; i++ ) out[ i ] = r[ i ] * w0;
+            for( int j = 1; j < n; j++ ) {
+                r = (const float*)rows[ j ];
+                float wj = w[ j ];
+                for( int i = i0; i < i1; i++ ) out[ i ] += r[ i ] * wj;
+            }
+        }
+        else {
+            for( int x = c0; x < c1; x++ ) v[ x ] = rows[ 0 ][ x ] * w[ 0 ];
+            for( int j = 1; j < n; j++ ) 
+                for( int x = c0; x < c1; x++ ) v[ x ] += rows[ j ][ x ] * w[ j ];
+        }
+    }
 
-template< class T > inline T blend_tent( const T& center, const T& edge1, const T& edge2, const T& edge3, const T& edge4, const T& corner1, const T& corner2, const T& corner3, const T& corner4 ) {
-    return ( center * 4 + ( edge1 + edge2 + edge3 + edge4 ) * 2 + corner1 + corner2 + corner3 + corner4 ) / 16;
-}
+    // output pixel x from vertical sums around 2x - weight is the product of the live weights both ways
+    template< class K > T edge( int x, int below_width, int wy ) {
+        T sum = T();
+        int wx = 0;
+        for( int i = 0; i < K::n; i++ ) {
+            int xb = 2 * x + K::first + i;
+            if( xb >= 0 && xb < below_width ) { sum += v[ xb ] * K::w[ i ]; wx += K::w[ i ]; }
+        }
+        return mip_divide( sum, wx * wy );
+    }
 
-template<> inline ucolor blend_tent( const ucolor& center, const ucolor& edge1, const ucolor& edge2, const ucolor& edge3, const ucolor& edge4, const ucolor& corner1, const ucolor& corner2, const ucolor& corner3, const ucolor& corner4 ) {
-   return
-   ( ( ( ( ( ( ( center & 0x00ff0000 ) << 2 ) + ( ( ( edge1 & 0x00ff0000 ) + ( edge2 & 0x00ff0000 ) + ( edge3 & 0x00ff0000 ) + ( edge4 & 0x00ff0000 ) ) << 1 ) + ( corner1 & 0x00ff0000 ) + ( corner2 & 0x00ff0000 ) + ( corner3 & 0x00ff0000 ) + ( corner4 & 0x00ff0000 ) ) >> 2 ) + 0x00080000 ) >> 4 ) & 0x00ff0000 ) + 
-   ( ( ( ( ( ( ( center & 0x0000ff00 ) << 2 ) + ( ( ( edge1 & 0x0000ff00 ) + ( edge2 & 0x0000ff00 ) + ( edge3 & 0x0000ff00 ) + ( edge4 & 0x0000ff00 ) ) << 1 ) + ( corner1 & 0x0000ff00 ) + ( corner2 & 0x0000ff00 ) + ( corner3 & 0x0000ff00 ) + ( corner4 & 0x0000ff00 ) ) >> 2 ) + 0x00000800 ) >> 4 ) & 0x0000ff00 ) + 
-   ( ( ( ( ( ( ( center & 0x000000ff ) << 2 ) + ( ( ( edge1 & 0x000000ff ) + ( edge2 & 0x000000ff ) + ( edge3 & 0x000000ff ) + ( edge4 & 0x000000ff ) ) << 1 ) + ( corner1 & 0x000000ff ) + ( corner2 & 0x000000ff ) + ( corner3 & 0x000000ff ) + ( corner4 & 0x000000ff ) ) >> 2 ) + 0x00000008 ) >> 4 ) & 0x000000ff ) + 
-   0xff000000; // blend alphas?
-}
+    // output pixels [ xa, xb ) of a row width wide
+    template< class K > void horizontal( T* out, int xa, int xb, int width, int below_width, int wy ) {
+        int x0, x1;
+        mip_interior< K >( width, below_width, x0, x1 );
+        x0 = std::clamp( x0, xa, xb );
+        x1 = std::clamp( x1, x0, xb );
+        for( int x = xa; x < x0; x++ ) out[ x ] = edge< K >( x, below_width, wy );
+        int wt = K::sum * wy;
+        if constexpr( std::is_same_v< T, frgb > || std::is_same_v< T, vec2f > ) {
+            constexpr int c = sizeof( T ) / sizeof( float );
+            const float* vf = (const float*)v.data();
+            float* of = (float*)out;
+            float scale = 1.0f / wt;
+            for( int x = x0; x < x1; x++ ) {
+                const float* p = vf + ( 2 * x + K::first ) * c;
+                for( int ch = 0; ch < c; ch++ ) {
+                    float sum = 0.0f;
+                    for( int i = 0; i < K::n; i++ ) sum += p[ i * c + ch ] * K::w[ i ];
+                    of[ x * c + ch ] = sum * scale;
+                }
+            }
+        }
+        else {
+            for( int x = x0; x < x1; x++ ) {
+                const T* p = &v[ 2 * x + K::first ];
+                T sum = p[ 0 ] * K::w[ 0 ];
+                for( int i = 1; i < K::n; i++ ) sum += p[ i ] * K::w[ i ];
+                out[ x ] = mip_divide( sum, wt );
+            }
+        }
+        for( int x = x1; x < xb; x++ ) out[ x ] = edge< K >( x, below_width, wy );
+    }
+};
+
+// ucolor keeps 16 bit sums for each channel (weights add up to 256 at most, so 255 * 256 fits)
+// and divides by multiplying with a 24 bit reciprocal, exact for sums below 65536
+template<> struct mip_sums< ucolor > {
+    std::vector< unsigned short > v;
+
+    void resize( int width ) { v.resize( width * 4 ); }
+
+    void vertical( const ucolor* const* rows, const int* w, int n, int c0, int c1 ) {
+        const unsigned char* r = (const unsigned char*)rows[ 0 ];
+        unsigned short w0 = w[ 0 ];
+        for( int k = c0 * 4; k < c1 * 4; k++ ) v[ k ] = r[ k ] * w0;
+        for( int j = 1; j < n; j++ ) {
+            r = (const unsigned char*)rows[ j ];
+            unsigned short wj = w[ j ];
+            for( int k = c0 * 4; k < c1 * 4; k++ ) v[ k ] += r[ k ] * wj;
+        }
+    }
 
-// edge case - center, three edges, two corners
-template< class T > inline T blend_tent_edge( const T& center, const T& edge1, const T& edge2, const T& edge3, const T& corner1, const T& corner2 ) {
-    return ( center * 4 + ( edge1 + edge2 + edge3 ) * 2 + corner1 + corner2 ) / 12;
-}
+    static inline unsigned int reciprocal( unsigned int wt ) { return ( ( 1u << 24 ) + wt - 1 ) / wt; }
 
-template<> inline ucolor blend_tent_edge( const ucolor& center, const ucolor& edge1, const ucolor& edge2, const ucolor& edge3, const ucolor& corner1, const ucolor& corner2 ) {
-   return
-   ( ( ( ( ( ( ( center & 0x00ff0000 ) << 2 ) + ( ( ( edge1 & 0x00ff0000 ) + ( edge2 & 0x00ff0000 ) + ( edge3 & 0x00ff0000 ) ) << 1 ) + ( corner1 & 0x00ff0000 ) + ( corner2 & 0x00ff0000 ) ) >> 2 ) + 0x00060000 ) / 12 ) & 0x00ff0000 ) + 
-   ( ( ( ( ( ( ( center & 0x0000ff00 ) << 2 ) + ( ( ( edge1 & 0x0000ff00 ) + ( edge2 & 0x0000ff00 ) + ( edge3 & 0x0000ff00 ) ) << 1 ) + ( corner1 & 0x0000ff00 ) + ( corner2 & 0x0000ff00 ) ) >> 2 ) + 0x00000600 ) / 12 ) & 0x0000ff00 ) + 
-   ( ( ( ( ( ( ( center & 0x000000ff ) << 2 ) + ( ( ( edge1 & 0x000000ff ) + ( edge2 & 0x000000ff ) + ( edge3 & 0x000000ff ) ) << 1 ) + ( corner1 & 0x000000ff ) + ( corner2 & 0x000000ff ) ) >> 2 ) + 0x00000006 ) / 12 ) & 0x000000ff ) + 
-   0xff000000; // blend alphas?
-}
+    template< class K > void edge( unsigned char* o, int x, int below_width, int wy ) {
+        unsigned int sum[ 4 ] = { 0, 0, 0, 0 };
+        int wx = 0;
+        for( int i = 0; i < K::n; i++ ) {
+            int xb = 2 * x + K::first + i;
+            if( xb < 0 || xb >= below_width ) continue;
+            for( int c = 0; c < 4; c++ ) sum[ c ] += v[ xb * 4 + c ] * K::w[ i ];
+            wx += K::w[ i ];
+        }
+        unsigned int wt = wx * wy, recip = reciprocal( wt );
+        for( int c = 0; c < 4; c++ ) o[ x * 4 + c ] = (unsigned char)( ( ( sum[ c ] + wt / 2 ) * recip ) >> 24 );
+    }
+
+    template< class K > void horizontal( ucolor* out, int xa, int xb, int width, int below_width, int wy ) {
+        unsigned char* o = (unsigned char*)out;
+        int x0, x1;
+        mip_interior< K >( width, below_width, x0, x1 );
+        x0 = std::clamp( x0, xa, xb );
+        x1 = std::clamp( x1, x0, xb );
+        for( int x = xa; x < x0; x++ ) edge< K >( o, x, below_width, wy );
+        unsigned int wt = K::sum * wy, recip = reciprocal( wt ), half = wt / 2;
+        for( int x = x0; x < x1; x++ ) {
+            const unsigned short* p = &v[ ( 2 * x + K::first ) * 4 ];
+            for( int c = 0; c < 4; c++ ) {
+                unsigned int sum = half;
+                for( int i = 0; i < K::n; i++ ) sum += p[ i * 4 + c ] * K::w[ i ];
+                o[ x * 4 + c ] = (unsigned char)( ( sum * recip ) >> 24 );
+            }
+        }
+        for( int x = x1; x < xb; x++ ) edge< K >( o, x, below_width, wy );
+    }
+};
+
+// one band of one pass - levels [ from + 1, to ] of rows pulled up from level from
+template< class T, class K > struct mip_band {
+    std::vector< T* >& levels;
+    const std::vector< vec2i >& dims;
+    int from, to;
+    std::vector< vec2i > owned;                 // rows this band writes, per level
+    std::vector< std::vector< T > > scratch;    // rows worked out for neighbors' sake
+    std::vector< std::array< int, mip_ring > > tag;
+    std::vector< std::array< const T*, mip_ring > > ring;
+    std::vector< mip_sums< T > > sums;
+
+    mip_band( std::vector< T* >& levels_init, const std::vector< vec2i >& dims_init, int from_init, int to_init, int y0, int y1 ) 
+        : levels( levels_init ), dims( dims_init ), from( from_init ), to( to_init ),
+          owned( to + 1 ), scratch( to + 1 ), tag( to + 1 ), ring( to + 1 ), sums( to + 1 )
+    {
+        for( int l = from + 1; l <= to; l++ ) {
+            int shift = to - l;
+            owned[ l ] = { y0 << shift, y1 == dims[ to ].y ? dims[ l ].y : y1 << shift };
+            scratch[ l ].resize( dims[ l ].x * mip_ring );
+            tag[ l ].fill( -1 );
+            sums[ l ].resize( dims[ l - 1 ].x );
+        }
+    }
 
-// corner case - center, two edges, one corner
-template< class T > inline T blend_tent_corner( const T& center, const T& edge1, const T& edge2, const T& corner1 ) {
-    return ( center * 4 + ( edge1 + edge2 ) * 2 + corner1 ) / 9;
+    const T* row( int l, int y ) {
+        if( l == from ) return levels[ l ] + y * dims[ l ].x;
+        int slot = y % mip_ring;
+        if( tag[ l ][ slot ] == y ) return ring[ l ][ slot ];
+
+        const T* rows[ K::n ];
+        int w[ K::n ], n = 0, wy = 0;
+        for( int j = 0; j < K::n; j++ ) {
+            int yb = 2 * y + K::first + j;
+            if( yb < 0 || yb >= dims[ l - 1 ].y ) continue;
+            rows[ n ] = row( l - 1, yb );
+            w[ n++ ] = K::w[ j ];
+            wy += K::w[ j ];
+        }
+        T* out = ( y >= owned[ l ].x && y < owned[ l ].y ) ? levels[ l ] + y * dims[ l ].x : &scratch[ l ][ slot * dims[ l ].x ];
+        sums[ l ].vertical( rows, w, n, 0, dims[ l - 1 ].x );
+        sums[ l ].template horizontal< K >( out, 0, dims[ l ].x, dims[ l ].x, dims[ l - 1 ].x, wy );
+        tag[ l ][ slot ] = y;
+        ring[ l ][ slot ] = out;
+        return out;
+    }
+};
+
+template< class T, class K > static void mip_build( std::vector< T* >& levels, const std::vector< vec2i >& dims ) {
+    for( int from = 0; from + 1 < levels.size(); from += mip_pass_levels ) {
+        int to = std::min( from + mip_pass_levels, (int)levels.size() - 1 );
+        global_pool().parallel_for( dims[ to ].y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+            mip_band< T, K > band( levels, dims, from, to, y0, y1 );
+            for( int y = y0; y < y1; y++ ) band.row( to, y );
+        } );
+    }
 }
 
-template<> inline ucolor blend_tent_corner( const ucolor& center, const ucolor& edge1, const ucolor& edge2, const ucolor& corner1 ) {
-    unsigned int random_bit = fair_coin( gen );
-    return
-    ( ( ( ( ( ( ( center & 0x00ff0000 ) << 2 ) + ( ( ( edge1 & 0x00ff0000 ) + ( edge2 & 0x00ff0000 ) ) << 1 ) + ( corner1 & 0x00ff0000 ) ) >> 2 ) + 0x00040000 + random_bit ) / 9 ) & 0x00ff0000 ) + 
-    ( ( ( ( ( ( ( center & 0x0000ff00 ) << 2 ) + ( ( ( edge1 & 0x0000ff00 ) + ( edge2 & 0x0000ff00 ) ) << 1 ) + ( corner1 & 0x0000ff00 ) ) >> 2 ) + 0x00000400 + random_bit ) / 9 ) & 0x0000ff00 ) + 
-    ( ( ( ( ( ( ( center & 0x000000ff ) << 2 ) + ( ( ( edge1 & 0x000000ff ) + ( edge2 & 0x000000ff ) ) << 1 ) + ( corner1 & 0x000000ff ) ) >> 2 ) + 0x00000004 + random_bit ) / 9 ) & 0x000000ff ) + 
-    0xff000000; // blend alphas?
+// pixels of a level whose taps touch rectangle r of the level below - pixel x reads 2x + first ... 2x + first + n - 1
+template< class K > static bb2i mip_footprint( const bb2i& r, const vec2i& d ) {
+    vec2i lo( ( r.minv.x - K::first - K::n + 2 ) >> 1, ( r.minv.y - K::first - K::n + 2 ) >> 1 );
+    vec2i hi( ( ( r.maxv.x - 1 - K::first ) >> 1 ) + 1, ( ( r.maxv.y - 1 - K::first ) >> 1 ) + 1 );
+    return bb2i( linalg::max( lo, vec2i( 0, 0 ) ), linalg::min( hi, d ) );
 }
 
-#define MIP( xm, ym )   mip[ level ][ ( ym ) * mip_dim[ level ].x + ( xm ) ]
-#define BELOW( xb, yb ) mip[ level - 1 ][ ( yb ) * mip_dim[ level - 1 ].x + ( xb ) ]
+// rebuilds the pixels of each level above changed rectangle r of level 0
+template< class T, class K > static void mip_update( std::vector< T* >& levels, const std::vector< vec2i >& dims, bb2i r ) {
+    for( int l = 1; l < levels.size(); l++ ) {
+        r = mip_footprint< K >( r, dims[ l ] );
+        vec2i below = dims[ l - 1 ];
+        int c0 = std::max( 2 * r.minv.x + K::first, 0 ), c1 = std::min( 2 * ( r.maxv.x - 1 ) + K::first + K::n, below.x );
+        int rows = r.maxv.y - r.minv.y;
+        // small patches are not worth handing out
+        int chunks = rows * ( r.maxv.x - r.minv.x ) >= 16384 ? global_pool().size() : 1;
+        global_pool().parallel_for( rows, chunks, [ & ]( int y0, int y1, int ) {
+            mip_sums< T > sums;
+            sums.resize( below.x );
+            for( int y = r.minv.y + y0; y < r.minv.y + y1; y++ ) {
+                const T* in[ K::n ];
+                int w[ K::n ], n = 0, wy = 0;
+                for( int j = 0; j < K::n; j++ ) {
+                    int yb = 2 * y + K::first + j;
+                    if( yb < 0 || yb >= below.y ) continue;
+                    in[ n ] = levels[ l - 1 ] + yb * below.x;
+                    w[ n++ ] = K::w[ j ];
+                    wy += K::w[ j ];
+                }
+                sums.vertical( in, w, n, c0, c1 );
+                sums.template horizontal< K >( levels[ l ] + y * dims[ l ].x, r.minv.x, r.maxv.x, dims[ l ].x, below.x, wy );
+            }
+        } );
+    }
+}
 
 template< class T > void image< T >::mip_it() { // mip it good
     if( mip_me ) {
-        if( !mipped ) {
-            int level = 0;
-            // allocate mip map memory
-            while( mip_dim[ level ].x > 1 || mip_dim[ level ].y > 1 ) {
-                if( mip.size() <= level + 1 ) {
-                    mip.push_back( std::vector< T >( ( mip_dim[ level ].x + 1 ) / 2 * ( mip_dim[ level ].y + 1 ) / 2 ) );
-                    mip_dim.push_back( vec2i( ( mip_dim[ level ].x + 1 ) / 2, ( mip_dim[ level ].y + 1 ) / 2 ) );
-                }
-                level++;
-            }
+        if( !mipped || mip_dim.empty() || mip_dim[ 0 ] != dim ) {
+            mip_layout();
             mipped = true;
+            mip_utd = false;
         }
-        if( !mip_utd ) {
-            unsigned int mip_level, mip_blend;
-            // calculate mip-maps
-            if( kernel == MIP_BOX ) {
-                int maxx, maxy;
-                for( int level = 1; level < mip.size(); level++ ) {
-                    vec2i& m = mip_dim[ level ];
-                    vec2i& b = mip_dim[ level - 1 ];
-                    if( b.x % 2 ) maxx = m.x - 1; else maxx = m.x;
-                    if( b.y % 2 ) maxy = m.y - 1; else maxy = m.y;
-                    for( int y = 0; y < maxy; y++ ) {
-                        for( int x = 0; x < maxx; x++ ) {
-                            MIP( x, y ) = blend4< T >( 
-                                BELOW( x * 2,     y * 2 ),
-                                BELOW( x * 2 + 1, y * 2 ),
-                                BELOW( x * 2,     y * 2 + 1 ),
-                                BELOW( x * 2 + 1, y * 2 + 1 )
-                            );
-                        }
-                        if( b.x % 2 ) {
-                            // right edge
-                            MIP( m.x - 1, y ) = blend( 
-                                BELOW( b.x - 1, y * 2     ),
-                                BELOW( b.x - 1, y * 2 + 1 )
-                            );
-                        }
-                    }
-                    if( b.y % 2 ) {
-                        for( int x = 0; x < maxx; x++ ) {
-                            // bottom edge
-                            MIP( x, m.y - 1 ) = blend(
-                                BELOW( x * 2,     b.y - 1 ),
-                                BELOW( x * 2 + 1, b.y - 1 )
-                            );
-                        }
-                        if( b.x % 2 ) {
-                            // lower right corner
-                            MIP( m.x - 1, m.y - 1 ) = BELOW( b.x - 1, b.y - 1 );
-                        }
-                    }
-                }
-            }
-            else if( kernel == MIP_TENT ) {
-                int maxx, maxy;
-                for( int level = 1; level < mip.size(); level++ ) {
-                    vec2i& m = mip_dim[ level ];
-                    vec2i& b = mip_dim[ level - 1 ];
-                    // handle small mip-maps
-                    if( b.x % 2 ) maxx = m.x - 1; else maxx = m.x;
-                    if( b.y % 2 ) maxy = m.y - 1; else maxy = m.y;
-                    // upper left corner
-                    MIP( 0, 0 ) = blend_tent_corner( BELOW( 0, 0 ), BELOW( 0, 1 ), BELOW( 1, 0 ), BELOW( 1, 1 ) );
-                    // upper right corner
-                    if( b.x % 2 ) MIP( m.x - 1, 0 ) = blend_tent_corner( BELOW( b.x - 1, 0 ), BELOW( b.x - 2, 0 ), BELOW( b.x - 1, 1 ), BELOW( b.x - 2, 1 ) );
-                    if( b.y % 2 ) {
-                        // lower left corner
-                        MIP( 0, m.y - 1 ) = blend_tent_corner( BELOW( 0, b.y - 1 ), BELOW( 0, b.y - 2 ), BELOW( 1, b.y - 1 ), BELOW( 1, b.y - 2 ) );
-                        if( mip_dim[ level - 1 ].x % 2 ) {
-                            // lower right corner
-                            MIP( m.x - 1, m.y - 1 ) = blend_tent_corner( BELOW( b.x - 1, b.y - 1 ), BELOW( b.x - 2, b.y - 1 ), BELOW( b.x - 1, b.y - 2 ), BELOW( b.x - 2, b.y - 2 ) );
-                        }
-                    }
-                    // upper edge
-                    for( int x = 1; x < maxx; x++ ) {
-                        MIP( x, 0 ) = blend_tent_edge( 
-                            BELOW( x * 2,     0 ),
-                            BELOW( x * 2 - 1, 0 ),
-                            BELOW( x * 2 + 1, 0 ),
-                            BELOW( x * 2,     1 ),
-                            BELOW( x * 2 - 1, 1 ),
-                            BELOW( x * 2 + 1, 1 )
-                        );
-                    }
-                    for( int y = 1; y < maxy; y++ ) {
-                        // left edge
-                        MIP( 0, y ) = blend_tent_edge( 
-                            BELOW( 0, y * 2 ),
-                            BELOW( 0, y * 2 - 1 ),
-                            BELOW( 0, y * 2 + 1 ),
-                            BELOW( 1, y * 2 ),
-                            BELOW( 1, y * 2 - 1 ),
-                            BELOW( 1, y * 2 + 1 )
-                        );
-                        for( int x = 1; x < maxx; x++ ) {
-                            // central part of image
-                            MIP( x, y ) = blend_tent( 
-                                BELOW( x * 2,     y * 2 ),
-                                BELOW( x * 2 - 1, y * 2 ),
-                                BELOW( x * 2 + 1, y * 2 ),
-                                BELOW( x * 2,     y * 2 - 1 ),
-                                BELOW( x * 2,     y * 2 + 1 ),
-                                BELOW( x * 2 - 1, y * 2 - 1 ),
-                                BELOW( x * 2 + 1, y * 2 - 1 ),
-                                BELOW( x * 2 - 1, y * 2 + 1 ),
-                                BELOW( x * 2 + 1, y * 2 + 1 )
-                            );
-                        }
-                        if( b.x % 2 ) {
-                            // right edge
-                            MIP( m.x - 1, y ) = blend_tent_edge( 
-                                BELOW( b.x - 1, y * 2 ),
-                                BELOW( b.x - 2, y * 2 ),
-                                BELOW( b.x - 1, y * 2 - 1 ),
-                                BELOW( b.x - 1, y * 2 + 1 ),
-                                BELOW( b.x - 2, y * 2 - 1 ),
-                                BELOW( b.x - 2, y * 2 + 1 )
-                            );
-                        }
-                    }
-                    if( b.y % 2 ) {
-                        // bottom edge
-                        for( int x = 1; x < maxx; x++ ) {
-                            MIP( x, m.y - 1 ) = blend_tent_edge( 
-                                BELOW( x * 2,     b.y - 1 ),
-                                BELOW( x * 2 - 1, b.y - 1 ),
-                                BELOW( x * 2 + 1, b.y - 1 ),
-                                BELOW( x * 2,     b.y - 2 ),
-                                BELOW( x * 2 - 1, b.y - 2 ),
-                                BELOW( x * 2 + 1, b.y - 2 )
-                            );
-                        }
-                    }
-                }
+        if( !mip_utd || mip_dirty.size() ) {
+            std::vector< T* > levels( mip_dim.size() );
+            levels[ 0 ] = base.data();
+            for( int l = 1; l < levels.size(); l++ ) levels[ l ] = mip.data() + mip_offset[ l ];
+            // once the changes cover much of the image, the fused full build is quicker
+            long long area = 0;
+            for( auto& r : mip_dirty ) area += (long long)( r.maxv.x - r.minv.x ) * ( r.maxv.y - r.minv.y );
+            if( area * 4 > (long long)dim.x * dim.y ) mip_utd = false;
+            auto build = [ & ]( auto taps ) {
+                typedef decltype( taps ) K;
+                if( !mip_utd ) mip_build< T, K >( levels, mip_dim );
+                else for( auto& r : mip_dirty ) mip_update< T, K >( levels, mip_dim, r );
+            };
+            switch( kernel ) {
+                case MIP_BOX:      build( mip_taps< MIP_BOX      >() ); break;
+                case MIP_GAUSSIAN: build( mip_taps< MIP_GAUSSIAN >() ); break;
+                default:           build( mip_taps< MIP_TENT     >() ); break;
             }
             mip_utd = true;
+            mip_dirty.clear();
         }
     }
 }
 
+template< class T > void image< T >::mark_dirty() {
+    mip_utd = false;
+    mip_dirty.clear();
+}
+
+// Rectangles are kept apart while there are few of them. Past mip_max_dirty, the two whose bounding box 
+// adds the least area are merged, so separate clusters of changes stay separate.
+template< class T > void image< T >::mark_dirty( const bb2i& bb ) {
+    if( !mip_utd ) return;  // everything gets rebuilt anyway
+    vec2i lo = linalg::max( bb.minv, ipbounds.minv ), hi = linalg::min( bb.maxv, ipbounds.maxv );
+    if( lo.x >= hi.x || lo.y >= hi.y ) return;
+    bb2i r( lo, hi );
+    auto area = []( const bb2i& b ) { return (long long)( b.maxv.x - b.minv.x ) * ( b.maxv.y - b.minv.y ); };
+    auto join = []( const bb2i& a, const bb2i& b ) { return bb2i( linalg::min( a.minv, b.minv ), linalg::max( a.maxv, b.maxv ) ); };
+    for( auto& d : mip_dirty ) if( area( join( d, r ) ) == area( d ) ) return;  // already covered
+    mip_dirty.push_back( r );
+    if( mip_dirty.size() > mip_max_dirty ) {
+        int bi = 0, bj = 1;
+        long long best = -1;
+        for( int i = 0; i < mip_dirty.size(); i++ ) 
+            for( int j = i + 1; j < mip_dirty.size(); j++ ) {
+                long long grow = area( join( mip_dirty[ i ], mip_dirty[ j ] ) ) - area( mip_dirty[ i ] ) - area( mip_dirty[ j ] );
+                if( best < 0 || grow < best ) { best = grow; bi = i; bj = j; }
+            }
+        mip_dirty[ bi ] = join( mip_dirty[ bi ], mip_dirty[ bj ] );
+        mip_dirty.erase( mip_dirty.begin() + bj );
+    }
+}
+
+// Level 0 is the base image, so it has no storage of its own. The block only grows - an image that toggles
+// mip-mapping or shrinks keeps its memory, and the layout is only redone when the dimensions change.
+template< class T > void image< T >::mip_layout() {
+    mip_dim.assign( 1, dim );
+    mip_offset.assign( 1, 0 );
+    size_t size = 0;
+    while( mip_dim.back().x > 1 || mip_dim.back().y > 1 ) {
+        vec2i d( ( mip_dim.back().x + 1 ) / 2, ( mip_dim.back().y + 1 ) / 2 );
+        mip_offset.push_back( size );
+        mip_dim.push_back( d );
+        size += aligned_round< T >( (size_t)d.x * d.y );
+    }
+    if( mip.size() < size ) mip.resize( size );
+}
+
 template< class T > void image< T >::de_mip() {  
     mipped = false;
-    mip_utd = false;
-    // deallocate all mip-maps except base
-    // remove all elements of mip vector except first
-    if( mip.size() > 1 ) mip.erase( mip.begin() + 1, mip.end() );
-    if( mip_dim.size() > 1 ) mip_dim.erase( mip_dim.begin() + 1, mip_dim.end() );
+    mark_dirty();
 }
 
 template< class T > void image< T >::reset() { 
     set_dim( { 0, 0 } );
     de_mip(); 
+    // release the mip-map memory too
+    aligned_vector< T >().swap( mip );
+    mip_dim.clear();
+    mip_offset.clear();
+}
+
+template< class T > void image< T >::reuse( const vec2i& dims ) {
+    dim = dims;
+    refresh_bounds();
+    base.assign( dim.x * dim.y, T() );  // no reallocation while it fits
+    mip_me = false;
+    mipped = false;
+    kernel = MIP_TENT;
+    mark_dirty();
+}
+
+template< class T > void image< T >::reuse( const image< T >& img ) {
+    dim = img.dim;
+    bounds = img.bounds;
+    ipbounds = img.ipbounds;
+    fpbounds = ipbounds;    // as in the copy constructor
+    base.assign( img.base.begin(), img.base.end() );
+    mip_me = img.mip_me;
+    mipped = false;
+    kernel = MIP_TENT;
+    mark_dirty();
 }
 
 template< class T > void image< T >::use_mip( bool m ) {
@@ -226,11 +382,16 @@ template< class T > void image< T >::use_mip( bool m ) {
     */
 }
 
+template< class T > void image< T >::set_mip_kernel( const mip_kernel& k ) {
+    if( k != kernel ) mark_dirty();
+    kernel = k;
+}
+
 template< class T > const vec2i image< T >::get_dim() const { return dim; }
 
 // Reallocates base memory to match new dimensions, if needed
 template< class T > void image< T >::set_dim( const vec2i& dims ) {
-    if( dim != dims ) base.resize( dims.x * dims.y );
+    if( dim != dims ) { base.resize( dims.x * dims.y ); mark_dirty(); }
     dim = dims;
     refresh_bounds();
 }
@@ -332,19 +493,21 @@ template< class T > const T image< T >::sample ( const vec2f& v, const bool& smo
 // Fixed point version of sample
 
 template< class T > const T image< T >::sample ( const unsigned int mip_level, const unsigned int mip_blend, const vec2i& vi ) const  {
+    const T* lower = mip_data( mip_level );
+    const T* upper = mip_data( mip_level + 1 );
     int l_index = ( vi.x >> ( 16 + mip_level     ) ) + ( vi.y >> ( 16 + mip_level     ) ) * mip_dim[ mip_level     ].x;
     int u_index = ( vi.x >> ( 16 + mip_level + 1 ) ) + ( vi.y >> ( 16 + mip_level + 1 ) ) * mip_dim[ mip_level + 1 ].x;
 
     return  blendf(
                 blendf(
-                    blendf( mip[ mip_level ][ l_index ], mip[ mip_level ][ l_index + 1 ], ( ( vi.x >> ( mip_level ) ) & 0xffff ) / 65536.0f ),
-                    blendf( mip[ mip_level ][ l_index + mip_dim[ mip_level ].x ], mip[ mip_level ][ l_index + mip_dim[ mip_level ].x + 1 ], ( (  vi.x >> mip_level ) & 0xffff ) / 65536.0f ),
+                    blendf( lower[ l_index ], lower[ l_index + 1 ], ( ( vi.x >> ( mip_level ) ) & 0xffff ) / 65536.0f ),
+                    blendf( lower[ l_index + mip_dim[ mip_level ].x ], lower[ l_index + mip_dim[ mip_level ].x + 1 ], ( (  vi.x >> mip_level ) & 0xffff ) / 65536.0f ),
                     ( ( vi.y >> ( mip_level ) ) & 0xffff ) / 65536.0f 
                 ),
                 blendf(
-                    blendf( mip[ mip_level + 1 ][ u_index ], mip[ mip_level + 1 ][ u_index + 1 ], ( ( vi.x >> ( mip_level + 1 ) ) & 0xffff ) / 65536.0f ),
-                    blendf( mip[ mip_level ][ u_index + mip_dim[ mip_level + 1 ].x ], mip[ mip_level ][ u_index + mip_dim[ mip_level + 1 ].x + 1 ], ( ( vi.x >> ( mip_level + 1 ) ) & 0xffff ) / 65536.0f ),
-                    ( ( vi.y >> mip_level ) & 0xffff ) / 65536.0f 
+                    blendf( upper[ u_index ], upper[ u_index + 1 ], ( ( vi.x >> ( mip_level + 1 ) ) & 0xffff ) / 65536.0f ),
+                    blendf( upper[ u_index + mip_dim[ mip_level + 1 ].x ], upper[ u_index + mip_dim[ mip_level + 1 ].x + 1 ], ( ( vi.x >> ( mip_level + 1 ) ) & 0xffff ) / 65536.0f ),
+                    ( ( vi.y >> ( mip_level + 1 ) ) & 0xffff ) / 65536.0f 
                 ),
                 mip_blend / 65536.0f
             );
@@ -366,7 +529,7 @@ template< class T > void image< T >::crop_circle( const T& background, const flo
             else blendf( base[ y * dim.x + x ], background, ( 1.0f - sqrtf( r / r2 ) ) / ramp_width );
         }
     }
-    //mip_it(); 
+    mark_dirty();
 }
 
 // Colors black everything outside of a centered circle
@@ -405,6 +568,7 @@ template< class T > void image< T >::mirror(    const image< T >& in,
             it++;
         }
     }
+    mark_dirty();
 }
 
 template< class T > void image< T >::turn( const image< T >& in, const direction4& direction ) {
@@ -424,6 +588,7 @@ template< class T > void image< T >::turn( const image< T >& in, const direction
             }
         }
     }
+    mark_dirty();
 }
 
 template< class T > void image< T >::flip( const image< T >& in, const bool& flip_x, const bool& flip_y ) {
@@ -449,6 +614,7 @@ template< class T > void image< T >::flip( const image< T >& in, const bool& fli
         }
         else { std::copy( in.begin(), in.end(), begin() ); } // no change
     }
+    mark_dirty();
 }
 
 // copy image of same size ( may need to be able to scale as well )
@@ -456,11 +622,12 @@ template< class T > void image< T >::copy( const image< T >& img ) {
     set_dim( img.dim );
     set_bounds( img.bounds );
     std::copy( img.base.begin(), img.base.end(), base.begin() );
-    //mip_it();    
+    mark_dirty();
 }
 
 template< class T > void image< T >::fill( const T& c ) {
     std::fill( begin(), base.end(), c );
+    mark_dirty();
 }
 
 template< class T > void image< T >::fill( const T& c, const bb2i& bb ) {
@@ -473,8 +640,8 @@ template< class T > void image< T >::fill( const T& c, const bb2i& bb ) {
             auto end_it = base.begin() + ( y * dim.x + bb1.maxv.x - 1);
             std::fill( beg_it, end_it, c );
         }
+        mark_dirty( bb );
     }
-    //mip_it();
 }
 
 template< class T > void image< T >::fill( const T& c, const bb2f& bb ) {
@@ -490,6 +657,7 @@ template< class T > void image< T >::clear() {
 // Black and white noise
 template< class T > void image< T >::noise( const float& a ) {
     for( auto& pix : base ) { if( weighted_bit( a ) ) white( pix ); else black( pix ); }
+    mark_dirty();
 }
 
 template< class T > void image< T >::noise( const float& a, const bb2i& bb ) {
@@ -501,8 +669,8 @@ template< class T > void image< T >::noise( const float& a, const bb2i& bb ) {
                 if( weighted_bit( a ) ) white( base[ y * dim.x + x ] ); else black( base[ y * dim.x + x ] );
             }
         }
+        mark_dirty( bb );
     }
-    //mip_it();
 }
 
 template< class T > void image< T >::noise( const float& a, const bb2f& bb ) {
@@ -516,34 +684,126 @@ template< class T > void image< T >::apply_mask( const image< T >& layer, const
         ::apply_mask( *r, *l, *m, mmode );
         r++; l++; m++;
     }
-    //mip_it();
+    mark_dirty();
 }
 
-template< class T > void image< T >::splat( 
+// Splat scanline helpers. Generic versions work a pixel at a time; ucolor versions go through the batch kernels.
+
+// nearest neighbor samples along a scanline - coordinates are 16.16 fixed point and already clipped to the image
+template< class T > inline void splat_nearest( T* out, const T* src, int stride, vec2i s, const vec2i& step, int n ) {
+    for( int i = 0; i < n; i++, s += step ) out[ i ] = src[ ( s.y >> 16 ) * stride + ( s.x >> 16 ) ];
+}
+
+template<> inline void splat_nearest( ucolor* out, const ucolor* src, int stride, vec2i s, const vec2i& step, int n ) {
+    sample_nearest_n( out, src, stride, s.x, s.y, step.x, step.y, n );
+}
+
+template< class T > inline void splat_tint( T* c, const T& tint, int n ) {
+    for( int i = 0; i < n; i++ ) c[ i ] = mulc( c[ i ], tint );
+}
+
+template<> inline void splat_tint( ucolor* c, const ucolor& tint, int n ) { mulc_n( c, tint, n ); }
+
+template< class T > inline void splat_add( T* result, const T* layer, int n ) {
+    for( int i = 0; i < n; i++ ) addc( result[ i ], layer[ i ] );
+}
+
+template<> inline void splat_add( ucolor* result, const ucolor* layer, int n ) { addc_n( result, layer, n ); }
+
+template< class T > inline void splat_mask( T* result, const T* layer, const T* mask, int n, const mask_mode& mmode ) {
+    for( int i = 0; i < n; i++ ) ::apply_mask( result[ i ], layer[ i ], mask[ i ], mmode );
+}
+
+template<> inline void splat_mask( ucolor* result, const ucolor* layer, const ucolor* mask, int n, const mask_mode& mmode ) {
+    apply_mask_n( result, layer, mask, n, mmode );
+}
+
+// Narrows [ k0, k1 ) to the steps k where 0 <= start + k * step <= hi, so bounds are checked once per scanline
+static inline void clip_span( long long start, long long step, long long hi, int& k0, int& k1 ) {
+    auto floor_div = []( long long a, long long b ) { return a / b - ( ( a % b != 0 ) && ( ( a < 0 ) != ( b < 0 ) ) ); };
+    if( step == 0 ) {
+        if( start < 0 || start > hi ) k1 = k0;
+        return;
+    }
+    long long lo_k, hi_k;
+    if( step > 0 ) { lo_k = -floor_div( start, step ); hi_k = floor_div( hi - start, step ); }
+    else           { lo_k = -floor_div( hi - start, -step ); hi_k = floor_div( start, -step ); }
+    k0 = (int)std::max( (long long)k0, lo_k );
+    k1 = (int)std::min( (long long)k1, hi_k + 1 );
+}
+
+template< class T, bool has_mask, bool has_tint, bool smooth > 
+void splat_rows( const splat_setup< T >& s, T* out, const vec2i& dim, const bb2i& clip ) {
+    constexpr int chunk = 256;
+    T gbuf[ chunk ], mbuf[ has_mask ? chunk : 1 ];
+    const bb2i& sb = s.sbounds;
+    int x0 = std::max( { sb.minv.x, clip.minv.x, 0 } ), x1 = std::min( { sb.maxv.x, clip.maxv.x, dim.x } );
+    int y0 = std::max( { sb.minv.y, clip.minv.y, 0 } ), y1 = std::min( { sb.maxv.y, clip.maxv.y, dim.y } );
+    for( int y = y0; y < y1; y++ ) {
+        // coordinates at the left edge of the splat on this row
+        long long rx = s.gstart.x + (long long)( y - sb.minv.y ) * s.guny.x;
+        long long ry = s.gstart.y + (long long)( y - sb.minv.y ) * s.guny.y;
+        int k0 = x0 - sb.minv.x, k1 = x1 - sb.minv.x;
+        clip_span( rx, s.gunx.x, s.fixmax.x, k0, k1 );
+        clip_span( ry, s.gunx.y, s.fixmax.y, k0, k1 );
+        long long mx, my;
+        if constexpr( has_mask ) {
+            // a mask of different size can round just outside its own edge - skip those pixels rather than read past it
+            mx = s.mstart.x + (long long)( y - sb.minv.y ) * s.muny.x;
+            my = s.mstart.y + (long long)( y - sb.minv.y ) * s.muny.y;
+            clip_span( mx, s.munx.x, s.mfixmax.x, k0, k1 );
+            clip_span( my, s.munx.y, s.mfixmax.y, k0, k1 );
+        }
+        if( k0 >= k1 ) continue;
+        vec2i gs( (int)( rx + (long long)k0 * s.gunx.x ), (int)( ry + (long long)k0 * s.gunx.y ) );
+        vec2i ms;
+        if constexpr( has_mask ) ms = vec2i( (int)( mx + (long long)k0 * s.munx.x ), (int)( my + (long long)k0 * s.munx.y ) );
+        T* dst = out + y * dim.x + sb.minv.x + k0;
+        for( int i = 0, n = k1 - k0; i < n; i += chunk ) {
+            int c = std::min( chunk, n - i );
+            if constexpr( smooth ) {
+                for( int j = 0; j < c; j++, gs += s.gunx ) gbuf[ j ] = s.g->sample( s.mip_level, s.mip_blend, gs );
+                if constexpr( has_mask ) for( int j = 0; j < c; j++, ms += s.munx ) mbuf[ j ] = s.m->sample( s.mip_level, s.mip_blend, ms );
+            }
+            else {
+                splat_nearest( gbuf, s.gbase, s.g->get_dim().x, gs, s.gunx, c );
+                gs += c * s.gunx;
+                if constexpr( has_mask ) {
+                    splat_nearest( mbuf, s.mbase, s.m->get_dim().x, ms, s.munx, c );
+                    ms += c * s.munx;
+                }
+            }
+            if constexpr( has_tint ) splat_tint( gbuf, s.tint, c );
+            if constexpr( has_mask ) splat_mask( dst + i, gbuf, mbuf, c, s.mmode );
+            else splat_add( dst + i, gbuf, c );
+        }
+    }
+}
+
+template< class T > splat_setup< T > image< T >::splat_prepare( 
     const image< T >& splat_image,      // image of the splat
     const bool& smooth, 			    // smooth splat?
     const vec2f& center, 			    // coordinates of splat center
     const float& scale, 			    // radius of splat
     const float& theta, 			    // rotation in degrees
-    const std::optional< std::reference_wrapper< image< T > > > mask,  // optional mask image
+    const std::optional< std::reference_wrapper< const image< T > > > mask,  // optional mask image
     const std::optional< T >&     tint, // change the color of splat
     const mask_mode& mmode              // how will mask be applied to splat and backround?
-)  
+) const
 {  
-    std::cout << "splat: smooth = " << smooth << std::endl;
     const image< T >& g( splat_image );
-    T gval, mval;
+    splat_setup< T > s;
 
-    bool has_tint = tint.has_value();
-    T my_tint;
-    if( has_tint ) my_tint = *tint;
-    bool has_mask = mask.has_value();
+    s.has_tint = tint.has_value();
+    if( s.has_tint ) s.tint = *tint;
+    s.smooth = smooth;
+    s.mmode = mmode;
 
     float thrad = theta / 360.0 * TAU;              // theta in radians
     vec2i p = ipbounds.bb_map( center, bounds);     // center of splat in pixel coordinates
 	int size = scale / ( bounds.b2.x - bounds.b1.x ) * dim.x; // scale in pixel coordinates
-    bb2i sbounds( p, size );    // bounding box of splat
-	vec2f smin = bounds.bb_map( sbounds.minv, ipbounds );
+    s.sbounds = bb2i( p, size );    // bounding box of splat
+	vec2f smin = bounds.bb_map( s.sbounds.minv, ipbounds );
 	vec2f sc;
 	sc.x = (smin.x - center.x) / scale;
 	sc.y = (smin.y - center.y) / scale;
@@ -560,109 +820,195 @@ template< class T > void image< T >::splat(
 	uny = linalg::rot( -thrad, uny );
 
 	// convert vectors to splat pixel space - fixed point
-    vec2i scfix = ( vec2i )(( sc * g.dim / 2.0f + g.dim / 2.0f ) * 65536.0f );
-    vec2i unxfix = ( vec2i )( unx * g.dim / 2.0f * 65536.0f );
-    vec2i unyfix = ( vec2i )( uny * g.dim / 2.0f * 65536.0f );
-	vec2i sfix;
-    bb2i fixbounds( { 0, 0 }, { ( g.dim.x - 1 ) << 16, ( g.dim.y - 1 ) << 16 });
+    s.g      = &g;
+    s.gbase  = g.base.data();
+    s.gstart = ( vec2i )(( sc * g.dim / 2.0f + g.dim / 2.0f ) * 65536.0f );
+    s.gunx   = ( vec2i )( unx * g.dim / 2.0f * 65536.0f );
+    s.guny   = ( vec2i )( uny * g.dim / 2.0f * 65536.0f );
+    s.fixmax = { ( g.dim.x - 1 ) << 16, ( g.dim.y - 1 ) << 16 };
 
     // calculate mip level and blend constant of splat
-    unsigned int mip_level, mip_blend;
-    mip_level = 0;
-    while( unit_scale >> ( mip_level + 16 ) ) mip_level++;  // level is log2 of unit_scale
-    mip_blend = 0;
-    if( mip_level > 0 ) {
-        mip_blend = ( unit_scale >> mip_level ) & 0xffff;
-        mip_level--; 
+    s.mip_level = 0;
+    while( unit_scale >> ( s.mip_level + 16 ) ) s.mip_level++;  // level is log2 of unit_scale
+    s.mip_blend = 0;
+    if( s.mip_level > 0 ) {
+        s.mip_blend = ( unit_scale >> s.mip_level ) & 0xffff;
+        s.mip_level--; 
     }
 
-    std::cout << "mip_level: " << mip_level << " mip_blend: " << mip_blend << std::endl;
+    s.m = nullptr;
+    s.mbase = nullptr;
+    if( mask.has_value() ) {
+        // mask steps through its own pixel space, so it may be a different size from the splat image
+        const image< T >& m = mask->get();
+        s.m = &m;
+        s.mbase   = m.base.data();
+        s.mstart  = ( vec2i )(( sc * m.dim / 2.0f + m.dim / 2.0f ) * 65536.0f );
+        s.munx    = ( vec2i )( unx * m.dim / 2.0f * 65536.0f );
+        s.muny    = ( vec2i )( uny * m.dim / 2.0f * 65536.0f );
+        s.mfixmax = { ( m.dim.x << 16 ) - 1, ( m.dim.y << 16 ) - 1 };
+    }
+    return s;
+}
+
+template< class T > void image< T >::splat_draw( const splat_setup< T >& s, const bb2i& clip ) {
     // *** Critical loop below ***
     // Quick and dirty sampling, high speed but risk of aliasing. 
     // Should work best if splat is fairly large and smooth.
-    // future: add option to smooth sample into splat's mip-map
+    // Rows are clipped once, then each run of pixels is sampled, tinted and blended in batches.
     // future: add vector and color effects
-    if( has_mask ) {
-        const image< T >& m = mask->get();
-        // image and mask same size
-        if( m.dim == g.dim ) {
-            for( int x = sbounds.minv.x; x < sbounds.maxv.x; x++ ) {
-                sfix = scfix;
-                if( ( x >= 0 ) && ( x < dim.x ) ) {
-                    for( int y = sbounds.minv.y; y < sbounds.maxv.y; y++ ) {
-                        if( ( y >= 0 ) && ( y < dim.y ) && fixbounds.in_bounds( sfix ) ) {
-                            if( smooth ) { 
-                                gval = g.sample( mip_level, mip_blend, sfix );
-                                mval = m.sample( mip_level, mip_blend, sfix );
-                            }
-                            else {
-                                gval = g.base[ (sfix.y >> 16) * g.dim.x + (sfix.x >> 16) ];
-                                mval = m.base[ (sfix.y >> 16) * m.dim.x + (sfix.x >> 16) ];
-                            }
-                            if( has_tint ) ::apply_mask( base[ y * dim.x + x ], mulc( gval, my_tint ), mval, mmode );
-                            else ::apply_mask( base[ y * dim.x + x ], gval, mval, mmode );
-                        }                        
-                        sfix += unyfix;
-                    }
-                }
-                scfix += unxfix;
-            }
+    T* out = base.data();
+    switch( ( s.m != nullptr ) * 4 + s.has_tint * 2 + s.smooth ) {
+        case 0: splat_rows< T, false, false, false >( s, out, dim, clip ); break;
+        case 1: splat_rows< T, false, false, true  >( s, out, dim, clip ); break;
+        case 2: splat_rows< T, false, true,  false >( s, out, dim, clip ); break;
+        case 3: splat_rows< T, false, true,  true  >( s, out, dim, clip ); break;
+        case 4: splat_rows< T, true,  false, false >( s, out, dim, clip ); break;
+        case 5: splat_rows< T, true,  false, true  >( s, out, dim, clip ); break;
+        case 6: splat_rows< T, true,  true,  false >( s, out, dim, clip ); break;
+        case 7: splat_rows< T, true,  true,  true  >( s, out, dim, clip ); break;
+    }
+}
+
+template< class T > void image< T >::splat( 
+    const image< T >& splat_image,      // image of the splat
+    const bool& smooth, 			    // smooth splat?
+    const vec2f& center, 			    // coordinates of splat center
+    const float& scale, 			    // radius of splat
+    const float& theta, 			    // rotation in degrees
+    const std::optional< std::reference_wrapper< const image< T > > > mask,  // optional mask image
+    const std::optional< T >&     tint, // change the color of splat
+    const mask_mode& mmode              // how will mask be applied to splat and backround?
+)  
+{  
+    splat_setup< T > s = splat_prepare( splat_image, smooth, center, scale, theta, mask, tint, mmode );
+    splat_draw( s, ipbounds );
+    mark_dirty( s.sbounds );
+}
+
+// Warp engine - source coordinates are worked out a run of pixels at a time, then sampled in one pass with
+// the extend mode and smoothing fixed at compile time. Blocks of rows are spread over the thread pool.
+
+static constexpr int warp_chunk = 256;
+
+// calls fn with the extend mode as a compile time constant
+template< class F > static void with_extend( const image_extend& extend, F fn ) {
+    switch( extend ) {
+        case SAMP_REPEAT:  fn( std::integral_constant< image_extend, SAMP_REPEAT  >() ); break;
+        case SAMP_REFLECT: fn( std::integral_constant< image_extend, SAMP_REFLECT >() ); break;
+        default:           fn( std::integral_constant< image_extend, SAMP_SINGLE  >() ); break;
+    }
+}
+
+// same as image::index() - zero outside the image for SAMP_SINGLE, otherwise wrapped
+template< class T, image_extend E > static inline T warp_index( const T* base, const vec2i& dim, vec2i vi ) {
+    if constexpr( E == SAMP_SINGLE ) {
+        if( vi.x < 0 || vi.y < 0 || vi.x >= dim.x || vi.y >= dim.y ) return T();
+    }
+    else {
+        int xblock = vi.x / dim.x - ( vi.x % dim.x < 0 );
+        int yblock = vi.y / dim.y - ( vi.y % dim.y < 0 );
+        vi.x -= xblock * dim.x;
+        vi.y -= yblock * dim.y;
+        if constexpr( E == SAMP_REFLECT ) {
+            if( xblock & 1 ) vi.x = dim.x - 1 - vi.x;
+            if( yblock & 1 ) vi.y = dim.y - 1 - vi.y;
         }
-        else {        
-            unsigned int m_mip_level, m_mip_blend;
-            m_mip_level = mip_level;
-            m_mip_blend = mip_blend;
-            // if image and mask are different sizes, step through separately
-            vec2i mscfix = ( vec2i )(( sc * m.dim / 2.0f + m.dim / 2.0f ) * 65536.0f );
-            vec2i munxfix = ( vec2i )( unx * m.dim / 2.0f * 65536.0f );
-            vec2i munyfix = ( vec2i )( uny * m.dim / 2.0f * 65536.0f );
-            vec2i msfix;
-            bb2i  mfixbounds( { 0, 0 }, { ( m.dim.x - 1 ) << 16, ( m.dim.y - 1 ) << 16 }); 
-            for( int x = sbounds.minv.x; x < sbounds.maxv.x; x++ ) {
-                sfix = scfix;
-                msfix = mscfix;
-                if( ( x >= 0 ) && ( x < dim.x ) ) {
-                for( int y = sbounds.minv.y; y < sbounds.maxv.y; y++ ) {
-                    if( ( y >= 0 ) && ( y < dim.y ) && fixbounds.in_bounds( sfix ) ) {
-                            if( smooth ) { 
-                                gval = g.sample( mip_level, mip_blend, sfix );
-                                mval = m.sample( m_mip_level, m_mip_blend, msfix );
-                            }
-                            else {
-                                gval = g.base[ (sfix.y >> 16) * g.dim.x + (sfix.x >> 16) ];
-                                mval = m.base[ (msfix.y >> 16) * m.dim.x + (msfix.x >> 16) ];
-                            }
-                            if( has_tint ) ::apply_mask( base[ y * dim.x + x ], mulc( gval, my_tint ), mval, mmode );
-                            else           ::apply_mask( base[ y * dim.x + x ], gval, mval, mmode );
-                        }
-                        sfix  +=  unyfix;
-                        msfix += munyfix;
-                    }
-                }
-                scfix += unxfix;
-                mscfix += munxfix;
-            }
-        }      
+    }
+    return base[ vi.y * dim.x + vi.x ];
+}
+
+// rounds towards minus infinity the same way image::sample() does
+static inline vec2i warp_pixel( const vec2f& v ) {
+    vec2i vi = ( vec2i )v;
+    if( v.x < 0.0f ) vi.x -= 1;
+    if( v.y < 0.0f ) vi.y -= 1;
+    return vi;
+}
+
+// per thread storage for one run of pixels
+template< class T > struct warp_scratch {
+    std::vector< vec2f > v;         // source coordinates
+    std::vector< T > a, b, c, d;    // four neighbors for smooth sampling
+    std::vector< float > rx, ry;    // remainders for interpolation
+    warp_scratch() : v( warp_chunk ), a( warp_chunk ), b( warp_chunk ), c( warp_chunk ), d( warp_chunk ), rx( warp_chunk ), ry( warp_chunk ) {}
+};
+
+// blendf( blendf( a, b, rx ), blendf( c, d, rx ), ry ) over a run - a straight loop the compiler can vectorize
+template< class T > static void bilerp_n( T* out, const T* a, const T* b, const T* c, const T* d, const float* rx, const float* ry, int n ) {
+    for( int i = 0; i < n; i++ ) out[ i ] = blendf( blendf( a[ i ], b[ i ], rx[ i ] ), blendf( c[ i ], d[ i ], rx[ i ] ), ry[ i ] );
+}
+
+template<> void bilerp_n( ucolor* out, const ucolor* a, const ucolor* b, const ucolor* c, const ucolor* d, const float* rx, const float* ry, int n ) {
+    unsigned int px[ warp_chunk ], py[ warp_chunk ];
+    ucolor top[ warp_chunk ], bottom[ warp_chunk ];
+    for( int i = 0; i < n; i++ ) {
+        px[ i ] = (unsigned int)( rx[ i ] * 256.0f );   // as in blendf()
+        py[ i ] = (unsigned int)( ry[ i ] * 256.0f );
+    }
+    blend_n( top,    a,   b,      px, n );
+    blend_n( bottom, c,   d,      px, n );
+    blend_n( out,    top, bottom, py, n );
+}
+
+// samples n pixels of src at the coordinates in s.v (in pixels of src)
+template< class T, image_extend E, bool smooth > static void warp_run( T* out, const T* src, const vec2i& dim, warp_scratch< T >& s, int n ) {
+    if constexpr( !smooth ) {
+        for( int i = 0; i < n; i++ ) out[ i ] = warp_index< T, E >( src, dim, warp_pixel( s.v[ i ] ) );
     }
     else {
-        for( int x = sbounds.minv.x; x < sbounds.maxv.x; x++ ) {
-            sfix = scfix;
-            if( ( x >= 0 ) && ( x < dim.x ) ) {
-                for( int y = sbounds.minv.y; y < sbounds.maxv.y; y++ ) {
-                    if( ( y >= 0 ) && ( y < dim.y ) && fixbounds.in_bounds( sfix ) ) {
-                        if( smooth ) gval = g.sample( mip_level, mip_blend, sfix );
-                        else gval = g.base[ (sfix.y >> 16) * g.dim.x + (sfix.x >> 16) ];
-                        if( has_tint ) addc( base[ y * dim.x + x ], mulc( gval, my_tint ) );
-                        else           addc( base[ y * dim.x + x ], gval );
-                    }
-                    sfix += unyfix;
-                }
+        for( int i = 0; i < n; i++ ) {
+            vec2i vi = warp_pixel( s.v[ i ] );
+            s.rx[ i ] = s.v[ i ].x - (float)vi.x;
+            s.ry[ i ] = s.v[ i ].y - (float)vi.y;
+            if( vi.x >= 0 && vi.y >= 0 && vi.x + 1 < dim.x && vi.y + 1 < dim.y ) {  // all four neighbors inside - no wrapping
+                const T* p = src + vi.y * dim.x + vi.x;
+                s.a[ i ] = p[ 0 ];      s.b[ i ] = p[ 1 ];
+                s.c[ i ] = p[ dim.x ];  s.d[ i ] = p[ dim.x + 1 ];
+            }
+            else {
+                s.a[ i ] = warp_index< T, E >( src, dim, vi );
+                s.b[ i ] = warp_index< T, E >( src, dim, { vi.x + 1, vi.y } );
+                s.c[ i ] = warp_index< T, E >( src, dim, { vi.x, vi.y + 1 } );
+                s.d[ i ] = warp_index< T, E >( src, dim, { vi.x + 1, vi.y + 1 } );
             }
-            scfix += unxfix;
         }
+        bilerp_n( out, s.a.data(), s.b.data(), s.c.data(), s.d.data(), s.rx.data(), s.ry.data(), n );
     }
 }
 
+template< class T, image_extend E, bool smooth > static void warp_rows( T* out, const vec2i& dim, const T* src, const vec2i& src_dim, 
+    const bb2f& src_fpbounds, const bb2f& src_bounds, const std::function< void ( int, int, int, vec2f* ) >& coords ) 
+{
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        warp_scratch< T > s;
+        for( int y = y0; y < y1; y++ ) {
+            for( int x = 0; x < dim.x; x += warp_chunk ) {
+                int n = std::min( warp_chunk, dim.x - x );
+                coords( x, y, n, s.v.data() );
+                for( int i = 0; i < n; i++ ) s.v[ i ] = src_fpbounds.bb_map( s.v[ i ], src_bounds );
+                warp_run< T, E, smooth >( out + y * dim.x + x, src, src_dim, s, n );
+            }
+        }
+    } );
+}
+
+template< class T > void image< T >::warp ( const image< T >& in, 
+                                            const warp_runs& coords,
+                                            const bool& smooth,           // default false
+                                            const image_extend& extend )  // default SAMP_SINGLE 
+{
+    // in place warps sample the image as it was
+    decltype( base ) copy;
+    if( &in == this ) copy = base;
+    const T* src = ( &in == this ) ? copy.data() : in.base.data();
+    with_extend( extend, [ & ]( auto e ) {
+        if( smooth ) warp_rows< T, decltype( e )::value, true  >( base.data(), dim, src, in.dim, in.fpbounds, in.bounds, coords );
+        else         warp_rows< T, decltype( e )::value, false >( base.data(), dim, src, in.dim, in.fpbounds, in.bounds, coords );
+    } );
+    mark_dirty();
+}
+
 template< class T > void image< T >::warp (  const image< T >& in, 
                                     const image< vec2f >& vf, 
                                     const float& step,            // default 1.0
@@ -671,25 +1017,15 @@ template< class T > void image< T >::warp (  const image< T >& in,
                                     const image_extend& extend )  // default SAMP_SINGLE 
 {
     bool same_dims = compare_dims( vf ); // If vector field and input image are same dimension, interpolation not necessary
-    if( ( !relative ) && same_dims )
-        std::transform( begin(), end(), vf.begin(), begin(), [ &in, &smooth, &extend ] ( T &r, const vec2f &v ) { return in.sample( v, smooth, extend ); } );
-    else {
-        auto it = begin();
-        auto vfit = vf.begin();
-        vec2f v, coord;
-        bb2f vf_bounds = vf.get_bounds();
-        for( int y = 0; y < dim.y; y++ ) {
-            for( int x = 0; x < dim.x; x++ ) {
-                coord = bounds.bb_map( vec2i( x, y ), ipbounds );
-                if( same_dims ) { v = *vfit; vfit++; }
-                else { v = vf.sample( vf_bounds.bb_map( coord, bounds ), true ); }
-                if( relative ) v = v * step + coord;
-                *it = in.sample( v, smooth, extend );
-                it++;
-            }
+    bb2f vf_bounds = vf.get_bounds();
+    warp( in, [ & ]( int x, int y, int n, vec2f* v ) {
+        for( int i = 0; i < n; i++ ) {
+            vec2f coord = bounds.bb_map( vec2i( x + i, y ), ipbounds );
+            if( same_dims ) v[ i ] = vf.index( y * dim.x + x + i );
+            else v[ i ] = vf.sample( vf_bounds.bb_map( coord, bounds ), true );
+            if( relative ) v[ i ] = v[ i ] * step + coord;
         }
-    }
-    //mip_it();
+    }, smooth, extend );
 }
 
 template< class T > void image< T >::warp (  const image< T >& in, 
@@ -699,25 +1035,18 @@ template< class T > void image< T >::warp (  const image< T >& in,
                                     const bool& relative,         // default true
                                     const image_extend& extend )  // default SAMP_SINGLE 
 {
-    auto it = begin();
-    for( int y = 0; y < dim.y; y++ ) {
-        for( int x = 0; x < dim.x; x++ ) {
-            vec2f coord = bounds.bb_map( vec2i( x, y ), ipbounds );
-            vec2f v = vfn( coord );
-            if( relative ) v = v * step + coord;
-            *it = in.sample( v, smooth, extend );
-            it++;
-        }
-    }
-    //mip_it();
+    warp< std::function< vec2f( vec2f ) > >( in, vfn, step, smooth, relative, extend );
 }
 
 template< class T > void image< T >::warp ( const image< T >& in, 
                                             const image< int >& wf ) {
     if( !compare_dims( wf ) ) return; // Vector field and warp field must be same dimension
     if( !compare_dims( in ) ) return; // Vector field and input image must be same dimension
-    std::transform( begin(), end(), wf.begin(), begin(), [ &in ] ( T &r, const unsigned int &i ) { return in.index( i ); } );
-    //mip_it();
+    // in place warps read pixels already moved, so they stay in order on one thread
+    global_pool().parallel_for( dim.y, ( &in == this ) ? 1 : global_pool().size(), [ & ]( int y0, int y1, int ) {
+        for( int i = y0 * dim.x; i < y1 * dim.x; i++ ) base[ i ] = in.base[ wf.index( i ) ];
+    } );
+    mark_dirty();
 }
 
 template< class T > void image< T >::warp(  const image< T > &in, 
@@ -729,24 +1058,35 @@ template< class T > void image< T >::warp(  const image< T > &in,
     auto warp_bounds = ipbounds;
     if( of_extend == SAMP_SINGLE ) warp_bounds.intersect( bb2i( slide, slide + of.get_dim() ) );
 
-    vec2i v;
-    for ( v.y = warp_bounds.minv.y; v.y < warp_bounds.maxv.y; v.y++) {
-        auto it = begin() + v.y * dim.x + warp_bounds.minv.x;
-        for ( v.x = warp_bounds.minv.x; v.x < warp_bounds.maxv.x; v.x++) {
-            vec2i coord = of.index( v - slide, of_extend );
-            *it = in.index( v + coord , extend );
-            it++;
-        }
-    }
-    //mip_it();
+    with_extend( extend, [ & ]( auto e ) {
+        global_pool().parallel_for( warp_bounds.maxv.y - warp_bounds.minv.y, ( &in == this ) ? 1 : global_pool().size(), [ & ]( int y0, int y1, int ) {
+            vec2i v;
+            for ( v.y = warp_bounds.minv.y + y0; v.y < warp_bounds.minv.y + y1; v.y++) {
+                auto it = begin() + v.y * dim.x + warp_bounds.minv.x;
+                for ( v.x = warp_bounds.minv.x; v.x < warp_bounds.maxv.x; v.x++) {
+                    vec2i coord = of.index( v - slide, of_extend );
+                    *it = warp_index< T, decltype( e )::value >( in.base.data(), in.dim, v + coord );
+                    it++;
+                }
+            }
+        } );
+    } );
+    mark_dirty();
 }
 
 template< class T > void image< T >::read_binary(  const std::string &filename )
 {
+    if( is_image_file( filename ) ) {
+        mapped_image< T >( filename ).copy_to( *this );
+        return;
+    }
+
+    // headerless file from before image_file.hpp
     vec2i new_dim;
     bb2f new_bounds;
 
     std::ifstream in_file( filename, std::ios::in | std::ios::binary );
+    if( !in_file ) throw std::runtime_error( "image::read_binary: can't open " + filename );
     in_file.read( (char*)&new_dim, sizeof( vec2i ) );
     set_dim( new_dim );
     base.resize( dim.x * dim.y );
@@ -755,15 +1095,34 @@ template< class T > void image< T >::read_binary(  const std::string &filename )
     set_bounds( new_bounds );
 
     in_file.read( (char*)&(base[0]), dim.x * dim.y * sizeof( T ) );
-    //mip_it();
+    mark_dirty();
 }
 
-template< class T > void image< T >::write_binary( const std::string &filename )
+template< class T > void image< T >::write_binary( const std::string &filename, bool with_mip )
 {
+    std::vector< vec2i > dims( 1, dim );
+    if( with_mip ) {
+        bool m = mip_me;
+        mip_me = true;
+        mip_it();
+        mip_me = m;
+        dims = mip_dim;
+    }
+    std::vector< image_file_level > table;
+    image_file_header header = image_file_layout< T >( dims, bounds, kernel, table );
+
     std::ofstream out_file( filename, std::ios::out | std::ios::binary );
-    out_file.write( (char*)&dim, sizeof( vec2i ) );
-    out_file.write( (char*)&bounds, sizeof( bb2f ) );
-    out_file.write( (char*)&(base[0]), dim.x * dim.y * sizeof( T ) );
+    if( !out_file ) throw std::runtime_error( "image::write_binary: can't open " + filename );
+    out_file.write( (char*)&header, sizeof( header ) );
+    out_file.write( (char*)table.data(), table.size() * sizeof( image_file_level ) );
+    uint64_t written = sizeof( header ) + table.size() * sizeof( image_file_level );
+    static const char zeros[ cache_line ] = {};
+    for( int l = 0; l < dims.size(); l++ ) {
+        out_file.write( zeros, table[ l ].offset - written );   // pad to a cache line
+        uint64_t bytes = (uint64_t)dims[ l ].x * dims[ l ].y * sizeof( T );
+        out_file.write( (const char*)mip_data( l ), bytes );
+        written = table[ l ].offset + bytes;
+    }
     out_file.close();
 }
 
@@ -779,7 +1138,7 @@ template< class T > void image< T >::write_file(const std::string &filename, fil
 // apply a vector function to each point in image
 template< class T > void image< T >::apply( const std::function< T ( const T&, const float& ) > fn, const float& t ) {
     for( auto& v : base ) { v = fn( v, t ); }
-    //mip_it();
+    mark_dirty();
 } 
 
 // copy assignment
@@ -789,7 +1148,7 @@ template< class T > image< T >& image< T >::operator = ( const image< T >& rhs )
         dim = rhs.dim;
         bounds = rhs.bounds;
         ipbounds = rhs.ipbounds;
-        //mip_it();
+        mark_dirty();
     }
     return *this;
 }
@@ -801,7 +1160,7 @@ template< class T > image< T >& image< T >::operator = ( image< T >&& rhs ) {
         dim = rhs.dim;
         bounds = rhs.bounds;
         ipbounds = rhs.ipbounds;
-        //mip_it();
+        mark_dirty();
     }
     return *this;
 }
@@ -809,70 +1168,70 @@ template< class T > image< T >& image< T >::operator = ( image< T >&& rhs ) {
 template< class T > image< T >& image< T >::operator += ( image< T >& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), rhs.begin(), begin(), [] ( const T &a, const T &b ) { return a + b; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator += ( const T& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return a + rhs; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator -= ( image< T >& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), rhs.begin(), begin(), []( const T &a, const T &b ) { return a - b; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator -= ( const T& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return a - rhs; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator *= ( image< T >& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), rhs.begin(), begin(), [] ( const T &a, const T &b ) { return a * b; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator *= ( const T& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return a * rhs; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator *= ( const float& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return ( T )( a * rhs ); } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator /= ( image< T >& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), rhs.begin(), begin(), [] ( const T &a, const T &b ) { return a / b; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator /= ( const T& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return a / rhs; } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
 template< class T > image< T >& image< T >::operator /= ( const float& rhs ) {
     using namespace linalg;
     std::transform( begin(), base.end(), begin(), [ rhs ]( const T &a ) { return ( T )( a / rhs ); } );
-    //mip_it();
+    mark_dirty();
     return *this;
 }
 
@@ -8,11 +8,13 @@
 #include "vect2.hpp"
 #include "frgb.hpp"
 #include "ucolor.hpp"
+#include "aligned_alloc.hpp"
 #include <iterator>
 #include <vector>
 #include <memory>
 #include <optional>
 #include <functional>
+#include <type_traits>
 //#include "any_image.hpp"
 
 typedef enum image_extend
@@ -51,6 +53,28 @@ static bool diagonal(   direction8 d ) { return ( (int)d % 2 ); }
 
 template< class T > class image;
 
+// A splat with its transform worked out - 16.16 fixed point coordinates in splat (and mask) pixel space.
+// Made by image::splat_prepare() and drawn by image::splat_draw(), possibly a piece at a time.
+template< class T > struct splat_setup {
+    bb2i sbounds;               // bounding box of splat in target pixels
+    const image< T >* g;        // splat image
+    const T* gbase;
+    vec2i gstart, gunx, guny;   // splat coordinates at sbounds.minv, and per pixel steps in x and y
+    vec2i fixmax;               // largest coordinate inside the splat image
+    const image< T >* m;        // mask image - null if none, may be a different size
+    const T* mbase;
+    vec2i mstart, munx, muny, mfixmax;
+    unsigned int mip_level, mip_blend;
+    bool smooth;
+    bool has_tint;
+    T tint;
+    mask_mode mmode;
+};
+
+// Pixel storage - starts on a cache line, so loops over whole images begin aligned. Rows stay packed ( stride dim.x ),
+// as begin() / end() and index arithmetic throughout assume it. Specialize for a pixel type to give it another allocator.
+template< class T > struct image_storage { typedef aligned_vector< T > type; };
+
 // Root template for raster-based data
 template< class T > class image {
 
@@ -67,15 +91,20 @@ protected:
     bool mip_me;      // Use mip-mapping for this image? Default false.
     bool mipped;      // has mip-map been allocated?
     bool mip_utd;     // is mip-map up to date? Set to false with any modification of base image
+    std::vector< bb2i > mip_dirty;  // rectangles changed since the mip-map was built - only kept while mip_utd
+    static constexpr int mip_max_dirty = 8;
     mip_kernel kernel;
-    std::vector< std::vector< T > > mip;  // mip-map of image - first level points to base
+    aligned_vector< T > mip;  // mip-map levels 1 and up in one block - level 0 is base
     //std::vector< T >& base;  // Pixels
-    std::vector< T > base;  // Pixels
-    std::vector< vec2i > mip_dim;  // dimensions of mip-map levels (int)
+    typename image_storage< T >::type base;  // Pixels
+    std::vector< vec2i > mip_dim;  // dimensions of mip-map levels (int) - also the row stride of each level
+    std::vector< size_t > mip_offset;  // start of each level in mip, each on a cache line
     //std::vector< std::unique_ptr< bb2i > > ipbounds_mip;  // pixel space bounding box of mipped image (int)
     //std::vector< std::unique_ptr< bb2f > > fpbounds_mip;  // pixel space bounding box of mipped image (float)
     // resamples image to crate mip-map            
-    void de_mip();  // deallocate all mip-maps
+    void de_mip();  // mark mip-map unused - its memory is kept for the next mip_it() at the same size
+    void mip_layout();  // level dimensions and offsets for the current dim, sizing the block
+    const T* mip_data( const unsigned int& level ) const { return level ? mip.data() + mip_offset[ level ] : base.data(); }
 
 public:
     // default constructor - creates empty "stub" image
@@ -128,6 +157,9 @@ public:
         {
             // move mip map
             mip = std::move( img.mip );
+            mip_dim = std::move( img.mip_dim );
+            mip_offset = std::move( img.mip_offset );
+            mip_dirty = std::move( img.mip_dirty );
             base = std::move( img.base );
             //mip_it();
         }
@@ -136,8 +168,10 @@ public:
     image( const std::string& filename ) : image() { load( filename ); } 
 
     friend class vf_tools;  // additional functions for vector fields
+    template< class U > friend class mapped_image;  // fills in pixels and stored mip-map from a binary file
 
     T* get_base() { return &(base[0]); }    
+    const T* get_base() const { return &(base[0]); }
 
     //typedef std::iterator< std::forward_iterator_tag, std::vector< T > > image_iterator;
     auto begin() noexcept { return base.begin(); }
@@ -146,8 +180,15 @@ public:
     const auto end() const noexcept { return base.end(); }
 
     void reset();                          // clear memory & set dimensions to zero (mip_me remembered)
+    void reuse( const vec2i& dims );       // same as a new image( dims ), keeping this image's memory - see image_pool.hpp
+    void reuse( const image< T >& img );   // same as a copy constructed image, keeping this image's memory
     void use_mip( bool m );
+    void set_mip_kernel( const mip_kernel& k ); // kernel used by mip_it() - MIP_TENT by default
     void mip_it();  // mipit good
+    // Changes to the base image since the last mip_it(). Pixel modification functions call these themselves;
+    // set() and writes through begin() or get_base() don't, so call mark_dirty() after them.
+    void mark_dirty();                  // whole image changed - next mip_it() rebuilds every level
+    void mark_dirty( const bb2i& bb );  // pixels in bb changed - next mip_it() only rebuilds what they reach
     const vec2i get_dim() const;
     void set_dim( const vec2i& dims );
     void refresh_bounds(); // calculates default bounding boxes based on pixel dimensions
@@ -220,11 +261,24 @@ public:
         const vec2f& center = { 0.0f, 0.0f }, // coordinates of splat center
         const float& scale = 1.0f,  // radius of splat
         const float& theta = 0.0f,  // rotation in degrees
-        const std::optional< std::reference_wrapper< image< T > > > mask = std::nullopt,  // optional mask image
+        const std::optional< std::reference_wrapper< const image< T > > > mask = std::nullopt,  // optional mask image
         const std::optional< T >& tint = std::nullopt,       // change the color of the splat
         const mask_mode& mmode = MASK_BLEND // how will mask be applied to splat and backround?
     );  
 
+    // splat() in two steps, so a splat can be recorded and drawn later in pieces (see splat_batch.hpp)
+    splat_setup< T > splat_prepare( 
+        const image< T >& splat_image,
+        const bool& smooth = false,
+        const vec2f& center = { 0.0f, 0.0f },
+        const float& scale = 1.0f,
+        const float& theta = 0.0f,
+        const std::optional< std::reference_wrapper< const image< T > > > mask = std::nullopt,
+        const std::optional< T >& tint = std::nullopt,
+        const mask_mode& mmode = MASK_BLEND
+    ) const;
+    void splat_draw( const splat_setup< T >& s, const bb2i& clip );  // draws only the pixels inside clip - caller marks them dirty
+
     // warp with vector field
     void warp ( const image< T >& in, 
                 const image< vec2f >& vf, 
@@ -241,6 +295,33 @@ public:
                 const bool& relative = true,
                 const image_extend& extend = SAMP_SINGLE );
 
+    // warp with any callable vec2f( vec2f ) - called in place, no std::function per pixel
+    // may be called from several threads at once
+    template< class F > requires std::is_invocable_r_v< vec2f, const F&, vec2f >
+    void warp ( const image< T >& in, 
+                const F& vfn, 
+                const float& step = 1.0f, 
+                const bool& smooth = false, 
+                const bool& relative = true,
+                const image_extend& extend = SAMP_SINGLE ) 
+    {
+        warp( in, warp_runs( [ & ]( int x, int y, int n, vec2f* v ) {
+            for( int i = 0; i < n; i++ ) {
+                vec2f coord = bounds.bb_map( vec2i( x + i, y ), ipbounds );
+                v[ i ] = vfn( coord );
+                if( relative ) v[ i ] = v[ i ] * step + coord;
+            }
+        } ), smooth, extend );
+    }
+
+    // warp with coordinates from a function that fills in the source coordinates for n pixels 
+    // starting at target pixel ( x, y ). Called once per run of pixels, possibly from several threads at once
+    typedef std::function< void ( int x, int y, int n, vec2f* v ) > warp_runs;
+    void warp ( const image< T >& in, 
+                const warp_runs& coords,
+                const bool& smooth = false, 
+                const image_extend& extend = SAMP_SINGLE );
+
     // warp with warp field
     // can possibly slide by adding or subtracting int value from index
     void warp ( const image< T >& in,
@@ -254,12 +335,12 @@ public:
                 const image_extend& of_extend = SAMP_SINGLE );
 
     // load image from file - JPEG and PNG are only defined for fimage and uimage, so virtual function
-    // future - binary file type for any image (needed for vector field and out of range fimage)
+    // binary files work for any image, including vector fields and out of range fimage ( see image_file.hpp )
     void load( const std::string& filename ) { std::cout << "default image load" << std::endl; }
     void write_jpg( const std::string& filename, int quality ) { std::cout << "default image write_jpg" << std::endl; }
     void write_png( const std::string& filename ) { std::cout << "default image write_png" << std::endl; }
     void read_binary(  const std::string& filename );  
-    void write_binary( const std::string& filename );
+    void write_binary( const std::string& filename, bool with_mip = false );  // with_mip stores the mip-map too, building it if needed
     // determine file type from extension?
     void write_file( const std::string& filename, file_type ftype = FILE_JPG, int quality = 100 );
 
@@ -0,0 +1,134 @@
+#include "image_cache.hpp"
+#include "image_file.hpp"
+#include "fimage.hpp"
+#include "uimage.hpp"
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+// Named by a hash of the absolute path, so the same file reached through different relative paths shares an entry
+template< class T > std::string image_cache< T >::disk_name( const std::string& dir, const std::string& filename, long long mtime ) {
+    std::error_code ec;
+    std::string path = std::filesystem::absolute( filename, ec ).string();
+    if( ec ) path = filename;
+    std::stringstream ss;
+    ss << dir << "/" << std::hex << std::hash< std::string >()( path ) << "_" << mtime << "_" << image_file_type_of< T >::value << ".lxi";
+    return ss.str();
+}
+
+// A broken or unwritable disk cache never stops the load - the file is decoded as if there were no cache
+template< class T > std::shared_ptr< const image< T > > image_cache< T >::decode( const std::string& dir, const std::string& filename, long long mtime ) {
+    std::string cached;
+    if( dir.size() ) {
+        cached = disk_name( dir, filename, mtime );
+        if( is_image_file( cached ) ) {
+            try {
+                auto img = std::make_shared< image< T > >();
+                img->read_binary( cached );
+                return img;
+            }
+            catch( std::runtime_error& e ) {}
+        }
+    }
+    auto img = std::make_shared< image< T > >( filename );
+    if( dir.size() ) {
+        // written under another name first, so other processes never read half a file
+        std::string temp = cached + ".tmp" + std::to_string( std::random_device()() );
+        try {
+            img->write_binary( temp );
+            std::filesystem::rename( temp, cached );
+        }
+        catch( std::exception& e ) {
+            std::error_code ec;
+            std::filesystem::remove( temp, ec );
+        }
+    }
+    return img;
+}
+
+template< class T > void image_cache< T >::trim() {
+    while( bytes > max_bytes && !lru.empty() ) {
+        bytes -= lru.back().bytes;
+        index.erase( lru.back().filename );
+        lru.pop_back();
+    }
+}
+
+template< class T > std::shared_ptr< const image< T > > image_cache< T >::get( const std::string& filename ) {
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time( filename, ec );
+    if( ec ) return std::make_shared< const image< T > >( filename );  // not a file we can date - load as before
+    long long mtime = t.time_since_epoch().count();
+
+    std::string dir;
+    {
+        std::lock_guard< std::mutex > guard( lock );
+        auto it = index.find( filename );
+        if( it != index.end() ) {
+            if( it->second->mtime == mtime ) {
+                lru.splice( lru.begin(), lru, it->second );
+                return it->second->img;
+            }
+            // file has changed
+            bytes -= it->second->bytes;
+            lru.erase( it->second );
+            index.erase( it );
+        }
+        dir = disk_dir;
+    }
+
+    image_ptr img = decode( dir, filename, mtime );
+    vec2i dim = img->get_dim();
+    size_t img_bytes = (size_t)dim.x * dim.y * sizeof( T );
+
+    std::lock_guard< std::mutex > guard( lock );
+    auto it = index.find( filename );   // another thread may have decoded it meanwhile
+    if( it != index.end() ) {
+        bytes -= it->second->bytes;
+        lru.erase( it->second );
+        index.erase( it );
+    }
+    lru.push_front( { filename, mtime, img, img_bytes } );
+    index[ filename ] = lru.begin();
+    bytes += img_bytes;
+    trim();
+    return img;
+}
+
+template< class T > void image_cache< T >::set_max_bytes( size_t m ) {
+    std::lock_guard< std::mutex > guard( lock );
+    max_bytes = m;
+    trim();
+}
+
+template< class T > void image_cache< T >::set_disk_dir( const std::string& dir ) {
+    if( dir.size() ) {
+        std::error_code ec;
+        std::filesystem::create_directories( dir, ec );
+        if( ec ) throw std::runtime_error( "image_cache: can't create " + dir + " - " + ec.message() );
+    }
+    std::lock_guard< std::mutex > guard( lock );
+    disk_dir = dir;
+}
+
+template< class T > void image_cache< T >::clear() {
+    std::lock_guard< std::mutex > guard( lock );
+    lru.clear();
+    index.clear();
+    bytes = 0;
+}
+
+template< class T > size_t image_cache< T >::size() {
+    std::lock_guard< std::mutex > guard( lock );
+    return lru.size();
+}
+
+template< class T > size_t image_cache< T >::get_bytes() {
+    std::lock_guard< std::mutex > guard( lock );
+    return bytes;
+}
+
+// only fimage and uimage load from JPEG and PNG
+template class image_cache< frgb   >;      // fimage
+template class image_cache< ucolor >;      // uimage
@@ -0,0 +1,54 @@
+#ifndef __IMAGE_CACHE_HPP
+#define __IMAGE_CACHE_HPP
+
+#include "image.hpp"
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <string>
+
+// Decoded source images kept across scene loads, so reloading a scene or switching to a preset that uses the same
+// files skips JPEG and PNG decoding. Entries are keyed by path and modification time - a file that changes is decoded
+// again. Past max_bytes the least recently used images are dropped. With a disk directory set, decoded images are also
+// written there in the binary format ( image_file.hpp ), so a new process reads them back instead of decoding.
+
+template< class T > class image_cache {
+    typedef std::shared_ptr< const image< T > > image_ptr;
+    struct entry {
+        std::string filename;
+        long long mtime;
+        image_ptr img;
+        size_t bytes;
+    };
+    std::list< entry > lru;     // most recently used first
+    std::unordered_map< std::string, typename std::list< entry >::iterator > index;    // by filename
+    size_t bytes;
+    size_t max_bytes;
+    std::string disk_dir;       // empty for no disk cache
+    std::mutex lock;
+
+    std::string disk_name( const std::string& dir, const std::string& filename, long long mtime );  // file in dir for this version of filename
+    image_ptr decode( const std::string& dir, const std::string& filename, long long mtime );     // from dir if it's there, or from filename
+    void trim();                // drop least recently used entries past max_bytes
+
+public:
+    image_cache( size_t max_bytes_init = 256 << 20 ) : bytes( 0 ), max_bytes( max_bytes_init ) {}
+
+    // Decoded image, shared with later loads of the same file - copy it before changing it
+    // Images are decoded without holding the lock, so two threads missing on one file may both decode it
+    image_ptr get( const std::string& filename );
+
+    void set_max_bytes( size_t m );
+    void set_disk_dir( const std::string& dir );  // created if missing - empty turns the disk cache off
+    void clear();                                 // drops images in memory - the disk cache is kept
+    size_t size();                                // number of images in memory
+    size_t get_bytes();                           // their pixel memory
+};
+
+// Process-wide cache for each pixel type, created on first use
+template< class T > image_cache< T >& global_image_cache() {
+    static image_cache< T > cache;
+    return cache;
+}
+
+#endif // __IMAGE_CACHE_HPP
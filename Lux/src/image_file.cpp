@@ -0,0 +1,137 @@
+#include "image_file.hpp"
+#include "fimage.hpp"
+#include "uimage.hpp"
+#include "vector_field.hpp"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // __EMSCRIPTEN__
+
+static uint64_t image_file_round( uint64_t n ) { return ( n + cache_line - 1 ) / cache_line * cache_line; }
+
+template< class T > image_file_header image_file_layout( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table ) {
+    image_file_header header = {};
+    std::memcpy( header.magic, image_file_magic, sizeof( header.magic ) );
+    header.version = image_file_version;
+    header.byte_order = image_file_byte_order;
+    header.pixel_type = image_file_type_of< T >::value;
+    header.pixel_size = sizeof( T );
+    header.levels = dims.size();
+    header.kernel = kernel;
+    header.dim[ 0 ] = dims[ 0 ].x;
+    header.dim[ 1 ] = dims[ 0 ].y;
+    header.bounds[ 0 ] = bounds.minv.x;
+    header.bounds[ 1 ] = bounds.minv.y;
+    header.bounds[ 2 ] = bounds.maxv.x;
+    header.bounds[ 3 ] = bounds.maxv.y;
+    table.resize( dims.size() );
+    uint64_t offset = image_file_round( sizeof( image_file_header ) + dims.size() * sizeof( image_file_level ) );
+    for( size_t l = 0; l < dims.size(); l++ ) {
+        table[ l ].dim[ 0 ] = dims[ l ].x;
+        table[ l ].dim[ 1 ] = dims[ l ].y;
+        table[ l ].offset = offset;
+        offset = image_file_round( offset + (uint64_t)dims[ l ].x * dims[ l ].y * sizeof( T ) );
+    }
+    return header;
+}
+
+bool is_image_file( const std::string& filename ) {
+    char magic[ 4 ];
+    std::ifstream in_file( filename, std::ios::in | std::ios::binary );
+    return in_file.read( magic, sizeof( magic ) ) && !std::memcmp( magic, image_file_magic, sizeof( magic ) );
+}
+
+template< class T > mapped_image< T >::mapped_image( const std::string& filename ) : data( nullptr ), size( 0 ) {
+#ifndef __EMSCRIPTEN__
+    int fd = open( filename.c_str(), O_RDONLY );
+    if( fd < 0 ) throw std::runtime_error( "mapped_image: can't open " + filename );
+    struct stat st;
+    if( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+        void* p = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( p != MAP_FAILED ) { data = (const unsigned char*)p; size = st.st_size; }
+    }
+    close( fd );    // the mapping keeps the file open
+    if( !data ) throw std::runtime_error( "mapped_image: can't map " + filename );
+#else
+    std::ifstream in_file( filename, std::ios::in | std::ios::binary | std::ios::ate );
+    if( !in_file ) throw std::runtime_error( "mapped_image: can't open " + filename );
+    contents.resize( in_file.tellg() );
+    in_file.seekg( 0 );
+    in_file.read( (char*)contents.data(), contents.size() );
+    data = contents.data();
+    size = contents.size();
+#endif // __EMSCRIPTEN__
+
+    // check everything before any pixel is touched - fail() unmaps, as the destructor won't run
+    auto fail = [ & ]( const std::string& why ) {
+#ifndef __EMSCRIPTEN__
+        munmap( (void*)data, size );
+#endif // __EMSCRIPTEN__
+        throw std::runtime_error( "mapped_image: " + filename + " " + why );
+    };
+    if( size < sizeof( image_file_header ) ) fail( "is too short for a header" );
+    std::memcpy( &header, data, sizeof( image_file_header ) );
+    if( std::memcmp( header.magic, image_file_magic, sizeof( header.magic ) ) ) fail( "is not a binary image file" );
+    if( header.byte_order != image_file_byte_order ) fail( "was written with the other byte order" );
+    if( header.version > image_file_version ) fail( "has newer version " + std::to_string( header.version ) );
+    if( header.pixel_type != image_file_type_of< T >::value ) fail( "holds pixel type " + std::to_string( header.pixel_type ) + ", not " + std::to_string( image_file_type_of< T >::value ) );
+    if( header.pixel_size != sizeof( T ) ) fail( "has " + std::to_string( header.pixel_size ) + " byte pixels" );
+    if( header.levels < 1 || sizeof( image_file_header ) + (uint64_t)header.levels * sizeof( image_file_level ) > size ) fail( "has a bad level table" );
+    table.resize( header.levels );
+    std::memcpy( table.data(), data + sizeof( image_file_header ), header.levels * sizeof( image_file_level ) );
+    if( table[ 0 ].dim[ 0 ] != header.dim[ 0 ] || table[ 0 ].dim[ 1 ] != header.dim[ 1 ] ) fail( "has a bad level table" );
+    for( auto& t : table ) {
+        if( t.dim[ 0 ] < 0 || t.dim[ 1 ] < 0 || t.offset % cache_line ) fail( "has a bad level table" );
+        // compared so nothing can wrap - the pixel count is under 2^62, but offset + bytes or the count * sizeof( T ) may not be
+        uint64_t pixels = (uint64_t)t.dim[ 0 ] * t.dim[ 1 ];
+        if( t.offset > size || pixels > ( size - t.offset ) / sizeof( T ) ) fail( "is truncated" );
+    }
+}
+
+template< class T > mapped_image< T >::~mapped_image() {
+#ifndef __EMSCRIPTEN__
+    munmap( (void*)data, size );
+#endif // __EMSCRIPTEN__
+}
+
+// Stored levels are only used if they match the layout img would build itself - otherwise the mip-map is rebuilt when needed
+template< class T > void mapped_image< T >::copy_to( image< T >& img ) const {
+    vec2i d = get_dim();
+    img.set_dim( d );
+    img.set_bounds( get_bounds() );
+    const T* p = level_data( 0 );
+    std::copy( p, p + (size_t)d.x * d.y, img.base.begin() );
+    img.mark_dirty();
+    if( levels() > 1 ) {
+        img.mip_layout();
+        bool match = img.mip_dim.size() == (size_t)levels();
+        for( int l = 0; match && l < levels(); l++ ) match = img.mip_dim[ l ] == level_dim( l );
+        if( match ) {
+            for( int l = 1; l < levels(); l++ ) {
+                vec2i ld = level_dim( l );
+                std::copy( level_data( l ), level_data( l ) + (size_t)ld.x * ld.y, img.mip.begin() + img.mip_offset[ l ] );
+            }
+            img.kernel = get_mip_kernel();
+            img.mip_me = true;
+            img.mipped = true;
+            img.mip_utd = true;
+        }
+    }
+}
+
+template image_file_header image_file_layout< frgb   >( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+template image_file_header image_file_layout< ucolor >( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+template image_file_header image_file_layout< vec2f  >( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+template image_file_header image_file_layout< int    >( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+template image_file_header image_file_layout< vec2i  >( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+
+template class mapped_image< frgb   >;      // fimage
+template class mapped_image< ucolor >;      // uimage
+template class mapped_image< vec2f  >;      // vector_field
+template class mapped_image< int    >;      // warp_field
+template class mapped_image< vec2i  >;      // offset_field
@@ -0,0 +1,86 @@
+// Binary image files - a typed header, a table of levels, then the pixels of each level starting on a cache line
+// Level 0 is the image itself. Any further levels are a stored mip-map, read back instead of rebuilt.
+// Files are written in native byte order. The header records it, and files from a machine of the other order are refused.
+// Files from before the header ( dimensions, bounds, pixels ) are still read by image::read_binary().
+
+#ifndef __IMAGE_FILE_HPP
+#define __IMAGE_FILE_HPP
+
+#include "image.hpp"
+#include <cstdint>
+#include <string>
+
+static constexpr char image_file_magic[ 4 ] = { 'L', 'U', 'X', 'I' };
+static constexpr uint32_t image_file_version = 1;
+static constexpr uint32_t image_file_byte_order = 0x01020304;
+
+// pixel type stored in a file
+typedef enum image_file_type
+{
+    IMAGE_FILE_FRGB = 1,
+    IMAGE_FILE_UCOLOR,
+    IMAGE_FILE_VEC2F,
+    IMAGE_FILE_INT,
+    IMAGE_FILE_VEC2I
+} image_file_type;
+
+template< class T > struct image_file_type_of;
+template<> struct image_file_type_of< frgb   > { static constexpr image_file_type value = IMAGE_FILE_FRGB;   };
+template<> struct image_file_type_of< ucolor > { static constexpr image_file_type value = IMAGE_FILE_UCOLOR; };
+template<> struct image_file_type_of< vec2f  > { static constexpr image_file_type value = IMAGE_FILE_VEC2F;  };
+template<> struct image_file_type_of< int    > { static constexpr image_file_type value = IMAGE_FILE_INT;    };
+template<> struct image_file_type_of< vec2i  > { static constexpr image_file_type value = IMAGE_FILE_VEC2I;  };
+
+struct image_file_header {
+    char magic[ 4 ];
+    uint32_t version;
+    uint32_t byte_order;    // image_file_byte_order as written
+    uint32_t pixel_type;    // image_file_type
+    uint32_t pixel_size;    // sizeof( T ) - catches a change of pixel layout
+    uint32_t levels;        // 1 + number of stored mip-map levels
+    uint32_t kernel;        // mip_kernel the stored levels were built with
+    uint32_t reserved;
+    int32_t dim[ 2 ];
+    float bounds[ 4 ];      // minv.x, minv.y, maxv.x, maxv.y
+};
+
+// one per level, following the header
+struct image_file_level {
+    int32_t dim[ 2 ];
+    uint64_t offset;        // from the start of the file, on a cache line
+};
+
+// header, level table and pixel offsets for an image with the given level dimensions
+template< class T > image_file_header image_file_layout( const std::vector< vec2i >& dims, const bb2f& bounds, const mip_kernel& kernel, std::vector< image_file_level >& table );
+
+// true if filename starts with image_file_magic - false for files in the old headerless format
+bool is_image_file( const std::string& filename );
+
+// Read-only view of a binary image file. The file is mapped rather than read, so opening is quick whatever the size
+// and pixels are paged in as they are touched. Web builds have no mmap and read the whole file instead.
+template< class T > class mapped_image {
+    const unsigned char* data;  // whole file
+    size_t size;
+#ifdef __EMSCRIPTEN__
+    aligned_vector< unsigned char > contents;
+#endif // __EMSCRIPTEN__
+    image_file_header header;
+    std::vector< image_file_level > table;
+
+public:
+    mapped_image( const std::string& filename );
+    ~mapped_image();
+    mapped_image( const mapped_image& ) = delete;
+    mapped_image& operator = ( const mapped_image& ) = delete;
+
+    vec2i get_dim() const { return { header.dim[ 0 ], header.dim[ 1 ] }; }
+    bb2f get_bounds() const { return { { header.bounds[ 0 ], header.bounds[ 1 ] }, { header.bounds[ 2 ], header.bounds[ 3 ] } }; }
+    mip_kernel get_mip_kernel() const { return (mip_kernel)header.kernel; }
+    int levels() const { return (int)table.size(); }
+    vec2i level_dim( int level ) const { return { table[ level ].dim[ 0 ], table[ level ].dim[ 1 ] }; }
+    const T* level_data( int level ) const { return (const T*)( data + table[ level ].offset ); }  // rows packed, stride level_dim( level ).x
+
+    void copy_to( image< T >& img ) const;  // pixels and bounds, with the stored mip-map if there is one
+};
+
+#endif // __IMAGE_FILE_HPP
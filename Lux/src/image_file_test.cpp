@@ -0,0 +1,94 @@
+#include "image_file.hpp"
+#include "uimage.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <stdexcept>
+#include <functional>
+
+// Writes binary image files, reads them back, then damages the header and level table in ways a stale or hostile
+// file in a shared cache directory might, and checks mapped_image refuses each one before any pixel is read.
+// Usage: ./image_file_test
+
+static std::string dir = ( std::filesystem::temp_directory_path() / "image_file_test" ).string();
+
+static std::vector< char > read_file( const std::string& filename ) {
+    std::ifstream in_file( filename, std::ios::in | std::ios::binary );
+    return std::vector< char >( std::istreambuf_iterator< char >( in_file ), std::istreambuf_iterator< char >() );
+}
+
+static void write_file( const std::string& filename, const std::vector< char >& bytes ) {
+    std::ofstream out_file( filename, std::ios::out | std::ios::binary | std::ios::trunc );
+    out_file.write( bytes.data(), bytes.size() );
+}
+
+template< class V > static void poke( std::vector< char >& bytes, size_t at, V v ) { std::memcpy( bytes.data() + at, &v, sizeof( V ) ); }
+
+static bool report( const std::string& name, bool passed ) {
+    std::cout << "  " << name << ( passed ? " ok" : " FAILED" ) << std::endl;
+    return passed;
+}
+
+// read_binary() gives back the pixels and bounds written
+static bool round_trip( const uimage& img, bool with_mip ) {
+    std::string filename = dir + "/round_trip.lxi";
+    uimage out( img ), in;
+    out.write_binary( filename, with_mip );
+    in.read_binary( filename );
+    mapped_image< ucolor > m( filename );
+    bool same = in.get_dim() == img.get_dim() && in.get_bounds().minv == img.get_bounds().minv && in.get_bounds().maxv == img.get_bounds().maxv;
+    for( int i = 0; same && i < img.get_dim().x * img.get_dim().y; i++ ) same = in.index( i ) == img.index( i );
+    return report( std::string( "round trip" ) + ( with_mip ? " with mip-map" : "" ), same && ( m.levels() > 1 ) == with_mip );
+}
+
+// the file changed by damage() must be refused
+static bool refused( const std::string& name, const std::string& good, std::function< void ( std::vector< char >& ) > damage ) {
+    std::string filename = dir + "/damaged.lxi";
+    auto bytes = read_file( good );
+    damage( bytes );
+    write_file( filename, bytes );
+    try {
+        mapped_image< ucolor > m( filename );
+    }
+    catch( std::runtime_error& e ) {
+        return report( name, true );
+    }
+    return report( name, false );
+}
+
+int main( int argc, char** argv ) {
+    std::filesystem::create_directories( dir );
+    uimage img( vec2i( 4, 4 ) );
+    for( int i = 0; i < 16; i++ ) img.set( i, 0xff000000 | i * 0x010203 );
+
+    bool ok = true;
+    ok &= round_trip( img, false );
+    ok &= round_trip( img, true );
+
+    std::string good = dir + "/good.lxi";
+    img.write_binary( good, true );
+    const size_t table = sizeof( image_file_header );
+    const size_t level0_offset = table + offsetof( image_file_level, offset );
+    ok &= refused( "wrong magic", good, []( auto& b ) { b[ 0 ] = 'X'; } );
+    ok &= refused( "newer version", good, []( auto& b ) { poke( b, offsetof( image_file_header, version ), image_file_version + 1 ); } );
+    ok &= refused( "other pixel type", good, []( auto& b ) { poke( b, offsetof( image_file_header, pixel_type ), (uint32_t)IMAGE_FILE_FRGB ); } );
+    ok &= refused( "no levels", good, []( auto& b ) { poke( b, offsetof( image_file_header, levels ), (uint32_t)0 ); } );
+    ok &= refused( "table past the end", good, []( auto& b ) { poke( b, offsetof( image_file_header, levels ), (uint32_t)0xffffffff ); } );
+    ok &= refused( "offset off a cache line", good, [ & ]( auto& b ) { poke( b, level0_offset, (uint64_t)cache_line + 4 ); } );
+    ok &= refused( "offset past the end", good, [ & ]( auto& b ) { poke( b, level0_offset, (uint64_t)( b.size() + cache_line ) / cache_line * cache_line ); } );
+    // offset + pixel bytes wraps to a small number
+    ok &= refused( "offset that wraps", good, [ & ]( auto& b ) { poke( b, level0_offset, (uint64_t)0xffffffffffffffc0 ); } );
+    // pixel count * sizeof( T ) wraps
+    ok &= refused( "dimensions that wrap", good, [ & ]( auto& b ) {
+        int32_t dim[ 2 ] = { 0x7fffffff, 0x7fffffff };
+        poke( b, offsetof( image_file_header, dim ), dim );
+        poke( b, table, dim );
+    } );
+    ok &= refused( "truncated pixels", good, []( auto& b ) { b.resize( b.size() - 1 ); } );
+    ok &= refused( "truncated header", good, []( auto& b ) { b.resize( sizeof( image_file_header ) - 1 ); } );
+
+    std::filesystem::remove_all( dir );
+    std::cout << ( ok ? "all passed" : "FAILED" ) << std::endl;
+    return ok ? 0 : 1;
+}
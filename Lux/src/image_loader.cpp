@@ -31,3 +31,15 @@ void wrapped_write_png( const std::string& filename, const int xdim, const int y
     if( !ok ) 
         throw std::runtime_error (std::string( "Write jpeg error: \nFile" ) + filename + "\nReason:" + stbi_failure_reason() + "\n" ); 
 }
+
+void wrapped_write_png( FILE* out, const int xdim, const int ydim, const int channels, const unsigned char* data ) {
+    bool failed = false;
+    auto context = std::make_pair( out, &failed );
+    auto write = []( void* c, void* bytes, int size ) { 
+        auto* ctx = (std::pair< FILE*, bool* >*)c;
+        if( fwrite( bytes, 1, size, ctx->first ) != (size_t)size ) *ctx->second = true; 
+    };
+	int ok = stbi_write_png_to_func( write, &context, xdim, ydim, channels, data, xdim * channels );
+    if( !ok || failed ) 
+        throw std::runtime_error( std::string( "Write png error: stream\nReason:" ) + ( failed ? "write failed" : stbi_failure_reason() ) + "\n" ); 
+}
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <span>
+#include <cstdio>
 
 class image_loader {
     unsigned char *stbi_ptr;
@@ -26,4 +27,7 @@ void wrapped_write_jpg( const std :: string& filename, const int xdim, const int
 
 void wrapped_write_png( const std :: string& filename, const int xdim, const int ydim, const int channels, const unsigned char* data );
 
+// appends a complete PNG to an open file, for streams of frames
+void wrapped_write_png( FILE* out, const int xdim, const int ydim, const int channels, const unsigned char* data );
+
 #endif // __IMAGE_LOADER_HPP
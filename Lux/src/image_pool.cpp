@@ -0,0 +1,62 @@
+#include "image_pool.hpp"
+#include "fimage.hpp"
+#include "uimage.hpp"
+#include "vector_field.hpp"
+
+// Falls back to any spare image when none has the right size - its memory is reused as far as it goes
+template< class T > std::unique_ptr< image< T > > image_pool< T >::spare_for( const vec2i& dim ) {
+    std::lock_guard< std::mutex > guard( lock );
+    auto it = spare.find( { dim.x, dim.y } );
+    if( it == spare.end() ) it = spare.begin();
+    if( it == spare.end() ) return nullptr;
+    image_ptr img = std::move( it->second );
+    spare.erase( it );
+    return img;
+}
+
+template< class T > std::unique_ptr< image< T > > image_pool< T >::take( const vec2i& dim ) {
+    image_ptr img = spare_for( dim );
+    if( img ) img->reuse( dim );
+    else img = std::make_unique< image< T > >( dim );
+    return img;
+}
+
+template< class T > std::unique_ptr< image< T > > image_pool< T >::take( const image< T >& src ) {
+    image_ptr img = spare_for( src.get_dim() );
+    if( img ) img->reuse( src );
+    else img = std::make_unique< image< T > >( src );
+    return img;
+}
+
+template< class T > void image_pool< T >::give( image_ptr& img ) {
+    if( !img ) return;
+    vec2i dim = img->get_dim();
+    std::lock_guard< std::mutex > guard( lock );
+    spare.emplace( std::make_pair( dim.x, dim.y ), std::move( img ) );
+}
+
+template< class T > void image_pool< T >::clear() {
+    std::lock_guard< std::mutex > guard( lock );
+    spare.clear();
+}
+
+template< class T > size_t image_pool< T >::size() {
+    std::lock_guard< std::mutex > guard( lock );
+    return spare.size();
+}
+
+image_pools::image_pools() : pools( std::make_shared< image_pool< frgb > >(),
+                                    std::make_shared< image_pool< ucolor > >(),
+                                    std::make_shared< image_pool< vec2f > >(),
+                                    std::make_shared< image_pool< int > >(),
+                                    std::make_shared< image_pool< vec2i > >() ) {}
+
+void image_pools::clear() {
+    std::apply( []( auto&... p ) { ( p->clear(), ... ); }, pools );
+}
+
+template class image_pool< frgb >;
+template class image_pool< ucolor >;
+template class image_pool< vec2f >;
+template class image_pool< int >;
+template class image_pool< vec2i >;
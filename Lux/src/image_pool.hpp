@@ -0,0 +1,39 @@
+#ifndef __IMAGE_POOL_HPP
+#define __IMAGE_POOL_HPP
+
+#include "image.hpp"
+#include <map>
+#include <mutex>
+#include <tuple>
+
+// Images handed back by buffer pairs, kept for reuse by dimensions. A scene owns one pool per pixel type, so
+// resizing output, restarting or swapping sources borrows existing pixel memory instead of allocating it again.
+
+template< class T > class image_pool {
+    typedef std::unique_ptr< image< T > > image_ptr;
+    std::multimap< std::pair< int, int >, image_ptr > spare;    // keyed by ( x, y )
+    std::mutex lock;
+    image_ptr spare_for( const vec2i& dim );   // removes a spare image from the pool, null if there are none
+
+public:
+    image_ptr take( const vec2i& dim );                             // blank image, as image( dim ) would make
+    image_ptr take( const image< T >& img );                        // copy of img, as the copy constructor would make
+    void give( image_ptr& img );                                    // keep img for reuse - img is left null
+    void clear();                                                   // release all spare memory
+    size_t size();                                                  // number of spare images
+};
+
+// one pool for each pixel type in any_buffer_pair_ptr
+struct image_pools {
+    std::tuple< std::shared_ptr< image_pool< frgb > >,
+                std::shared_ptr< image_pool< ucolor > >,
+                std::shared_ptr< image_pool< vec2f > >,
+                std::shared_ptr< image_pool< int > >,
+                std::shared_ptr< image_pool< vec2i > > > pools;
+
+    image_pools();
+    template< class T > std::shared_ptr< image_pool< T > >& get() { return std::get< std::shared_ptr< image_pool< T > > >( pools ); }
+    void clear();
+};
+
+#endif // __IMAGE_POOL_HPP
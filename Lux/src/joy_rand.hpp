@@ -7,7 +7,7 @@
 #include "joy_concepts.hpp"
 
 static std::random_device rd;    // non-deterministic generator
-static std::mt19937 gen( rd() ); // start random engine
+static thread_local std::mt19937 gen( rd() ); // start random engine (one per thread so CA workers don't share state)
 static std::uniform_real_distribution<float> rand1( 0.0f, 1.0f );
 static std::uniform_int_distribution<unsigned int> fair_coin( 0, 1 );
 static std::uniform_int_distribution<unsigned int> rand_uint( 0, 0xffffffff ); 
@@ -3,6 +3,7 @@
 #include "ucolor.hpp"
 #include "vect2.hpp"
 #include "scene.hpp"
+#include "thread_pool.hpp"
 
 // Moore neighborhood shortcuts
 // First eight rotate counterclockwise from upper middle
@@ -63,8 +64,17 @@
 }
 */
 
-// evaluates conditions then executes rule
-template< class T > void CA< T >::run_rule() {
+template< class T > int CA< T >::stripe_count( int n ) {
+    return std::max( std::min( threads > 0 ? threads : (int)global_pool().size(), n ), 1 );
+}
+
+// evaluates conditions then executes rule. Called with the concrete rule type so the call can be inlined;
+// with checked false no conditions are active and the rule runs unconditionally
+template< class T > template< class U, bool checked > inline void CA< T >::run_rule( U& r ) {
+    if constexpr( !checked ) { 
+        r( *this ); 
+        return; 
+    }
     bool block = false;
     if( *p < 1.0f ) if( rand1( gen ) > *p ) block = true;
     if( *edge_block ) if( x <= 0 || x >= dim.x - 1 || y <= 0 || y >= dim.y - 1 ) block = true;
@@ -87,10 +97,110 @@ template< class T > void CA< T >::run_rule() {
         else result = neighbors; // Margolus family assumed
     }
     else {
-        rule( *this );
+        r( *this );
     }
 } 
 
+// Scans columns x0 to x1 - 1 from row y0 down to y1 - 1 with a sliding 3x3 window. Reads only from in and
+// writes only its own rectangle of out, so stripes and tiles can run concurrently. Uses toroidal boundary conditions
+template< class T > template< class U, bool checked > void CA< T >::run_moore( U& r, const_pixel_it in, pixel_it out, const_pixel_it tar, int x0, int x1, int y0, int y1 ) {
+    for( x = x0; x < x1; x++ ) {
+        int xl = x == 0 ? dim.x - 1 : x - 1;
+        int xr = x == dim.x - 1 ? 0 : x + 1;
+        // set initial neighborhood - row above the top row wraps to bottom of image
+        auto up  = in + ( y0 == 0 ? dim.y - 1 : y0 - 1 ) * dim.x;
+        auto mid = in + y0 * dim.x;
+        UL = *( up  + xl ); UM = *( up  + x ); UR = *( up  + xr );
+        ML = *( mid + xl ); MM = *( mid + x ); MR = *( mid + xr );
+        auto down = mid + dim.x;
+        auto out_it = out + y0 * dim.x + x;
+        auto tar_it = tar + y0 * dim.x + x;
+        for( y = y0; y < y1; y++ ) {
+            if( y == dim.y - 1 ) down = in; // row below wraps to top of image
+            DL = *( down + xl ); DM = *( down + x ); DR = *( down + xr );
+            run_rule< U, checked >( r );  // apply rule
+            if( targeted ) {    // if targeted, compare with target
+                if( manhattan( *tar_it, result[0] ) < manhattan( *tar_it, MM ) ) *out_it = result[0];
+                else *out_it = MM;
+                tar_it += dim.x;
+            }
+            else *out_it = result[0];        // set output
+            out_it += dim.x;
+            down += dim.x;
+            // update neighborhood
+            UL = ML; UM = MM; UR = MR;
+            ML = DL; MM = DM; MR = DR;
+        }
+    }
+}
+
+// Applies rule to Margolus blocks bx0 to bx1 - 1 in block rows by0 to by1 - 1. Upper left corners of blocks are
+// offset by ( startx, starty ) - starty may be -1. Blocks straddling the image edges wrap around. Each block reads
+// only from in and writes only its own four cells of out, so block rows can run concurrently
+template< class T > template< class U, bool checked > void CA< T >::run_margolus( U& r, const_pixel_it in, pixel_it out, const_pixel_it tar, int startx, int starty, int bx0, int bx1, int by0, int by1 ) {
+    for( int by = by0; by < by1; by++ ) {
+        y = starty + 2 * by;
+        int upper = ( ( y + dim.y ) % dim.y ) * dim.x;
+        int lower = ( ( y + 1 ) % dim.y ) * dim.x;
+        for( int bx = bx0; bx < bx1; bx++ ) {
+            x = startx + 2 * bx;
+            int xr = ( x + 1 ) % dim.x;
+            int ul = upper + x, ur = upper + xr, ll = lower + x, lr = lower + xr;
+            // set neighborhood
+            MUL = *( in + ul ); MUR = *( in + ur ); MLL = *( in + ll ); MLR = *( in + lr );
+            run_rule< U, checked >( r );  // apply rule
+            if( targeted ) { // keep result only if it gets closer to target. Rule may reorder neighbors, so compare against input
+                TUL = *( tar + ul ); TUR = *( tar + ur ); TLL = *( tar + ll ); TLR = *( tar + lr );
+                if( manhattan( RUL, TUL ) + manhattan( RUR, TUR ) + manhattan( RLR, TLR ) + manhattan( RLL, TLL ) >=
+                    manhattan( *( in + ul ), TUL ) + manhattan( *( in + ur ), TUR ) + manhattan( *( in + lr ), TLR ) + manhattan( *( in + ll ), TLL ) ) 
+                    { RUL = *( in + ul ); RUR = *( in + ur ); RLL = *( in + ll ); RLR = *( in + lr ); }
+            }
+            *( out + ul ) = RUL; *( out + ur ) = RUR; *( out + ll ) = RLL; *( out + lr ) = RLR;
+        }
+    }
+}
+
+// Compares image with buffer tile by tile. After a swap the buffer holds the previous frame's input, so any difference
+// means the tile changed last frame - by the rule or by another effect drawing into the image. A tile is evaluated if
+// it or a tile bordering it has changed within one period of the neighborhood's block offsets. Skipped tiles already
+// match in the buffer, so they are left in place
+template< class T > std::vector< vec2i > CA< T >::active_tiles( const_pixel_it in, pixel_it out ) {
+    if( tile_size < 2 || tile_size % 2 ) throw std::runtime_error( "CA: tile_size must be even" );
+    vec2i t( ( dim.x + tile_size - 1 ) / tile_size, ( dim.y + tile_size - 1 ) / tile_size );
+    if( t != tiles ) {  // new or resized image - everything starts active
+        tiles = t;
+        last_change.assign( tiles.x * tiles.y, ca_frame );
+    }
+    int period = hood == HOOD_MOORE ? 1 : ( hood == HOOD_MARGOLUS ? 2 : 4 );
+    std::vector< char > hot( tiles.x * tiles.y );
+    for( int ty = 0; ty < tiles.y; ty++ ) {
+        int y0 = ty * tile_size, y1 = std::min( y0 + tile_size, dim.y );
+        for( int tx = 0; tx < tiles.x; tx++ ) {
+            int x0 = tx * tile_size, x1 = std::min( x0 + tile_size, dim.x );
+            int& last = last_change[ ty * tiles.x + tx ];
+            for( int row = y0; row < y1 && last != ca_frame; row++ ) {
+                if( !std::equal( in + row * dim.x + x0, in + row * dim.x + x1, out + row * dim.x + x0 ) ) last = ca_frame;
+            }
+            hot[ ty * tiles.x + tx ] = ca_frame - last < period;
+        }
+    }
+    // Margolus blocks are offset by up to one pixel, so a block tile also reads from the next tile right and the tile above
+    std::vector< vec2i > active;
+    for( int ty = 0; ty < tiles.y; ty++ ) {
+        for( int tx = 0; tx < tiles.x; tx++ ) {
+            bool near = false;
+            for( int dy = -1; dy <= 1 && !near; dy++ ) {
+                for( int dx = -1; dx <= 1 && !near; dx++ ) {
+                    near = hot[ ( ( ty + dy + tiles.y ) % tiles.y ) * tiles.x + ( tx + dx + tiles.x ) % tiles.x ];
+                }
+            }
+            if( near ) active.push_back( vec2i( tx, ty ) );
+        }
+    }
+    active_fraction = (float)active.size() / ( tiles.x * tiles.y );
+    return active;
+}
+
 // future - implement multiresolution rule on mip-map
 // Uses toroidal boundary conditions
 template< class T > void CA< T >::operator() ( any_buffer_pair_ptr& buf, element_context& context ) {
@@ -108,7 +218,7 @@ template< class T > void CA< T >::operator() ( any_buffer_pair_ptr& buf, element
         auto buf_ptr = std::get< std::shared_ptr< buffer_pair< T > > >( buf ); 
         auto tar_ptr = buf_ptr;
         if( !buf_ptr->has_image() ) throw std::runtime_error( "CA: no image buffer" );
-        auto img = buf_ptr->get_image();
+        auto& img = buf_ptr->read_image();
         auto in =  img.begin();
         auto out = buf_ptr->get_buffer().begin();
         auto tar = in;
@@ -118,7 +228,7 @@ template< class T > void CA< T >::operator() ( any_buffer_pair_ptr& buf, element
                 // future: handle different target dimensions
                 if( tar_ptr.get() ) {   // check for null pointer
                     if( tar_ptr->has_image() ) {
-                        if( tar_ptr->get_image().get_dim() == img.get_dim() ) tar = tar_ptr->get_image().begin();
+                        if( tar_ptr->read_image().get_dim() == img.get_dim() ) tar = tar_ptr->read_image().begin();
                         else {
                             std::cout << "CA: target buffer dimensions do not match" << std::endl;
                             throw std::runtime_error( "CA: target buffer dimensions do not match" );
@@ -137,84 +247,32 @@ template< class T > void CA< T >::operator() ( any_buffer_pair_ptr& buf, element
         }
         dim = img.get_dim();
 
-        // check neighborhood type
-        if( hood == HOOD_MOORE ) {
-            neighbors.resize( 9 );
-            result.resize( 1 );
-            if( targeted ) targ.resize( 1 );
-            auto out_it = out;
-            auto dl_it = in;
-            auto dm_it = in;
-            auto dr_it = in;
-            auto tar_it = tar;
-            // scan through image by column
-            for( x = 0; x < dim.x; x++ ) {
-                // set intial neighborhood
-                if( x == 0 ) {
-                    UL = *(in + ( dim.y - 1 ) * dim.x + dim.x - 1);
-                    ML = *(in + dim.x - 1);
-                    dl_it = in + (2 * dim.x - 1); 
-                }
-                else {
-                    UL = *(in + ( dim.y - 1 ) * dim.x + x - 1);
-                    ML = *(in + x - 1);
-                    dl_it = in + (dim.x + x - 1);
-                }
-                DL = *dl_it;
-                UM = *(in + ( dim.y - 1 ) * dim.x + x);
-                MM = *(in + x); 
-                dm_it = in + (dim.x + x); DM = *dm_it;
-                if( x == dim.x - 1 ) {
-                    UR = *(in + ( dim.y - 1 ) * dim.x);
-                    MR = *in; 
-                    dr_it = in + dim.x; 
-                }
-                else {
-                    UR = *(in + ( dim.y - 1 ) * dim.x + x + 1);
-                    MR = *(in + x + 1);
-                    dr_it = in + (dim.x + x + 1);
-                }
-                DR = *dr_it;
-                out_it = out + x;
-                if( targeted ) tar_it = tar + x;
-                for( y = 0; y < dim.y - 1; y++ ) {
-                    run_rule();  // apply rule
-                    if( targeted ) {    // if targeted, compare with target
-                        if( manhattan( *tar_it, result[0] ) < manhattan( *tar_it, MM ) ) *out_it = result[0];
-                        else *out_it = MM;
-                    }
-                    else *out_it = result[0];        // set output
-                    out_it += dim.x;
-                    if( targeted ) tar_it += dim.x;
-                    // update neighborhood
-                    UL = ML; UM = MM; UR = MR;
-                    ML = DL; MM = DM; MR = DR;
-                    dl_it += dim.x; dm_it += dim.x; dr_it += dim.x;
-                    DL = *dl_it; DM = *dm_it; DR = *dr_it;
-                }
-                // set last row
-                if( x == 0 ) DL = *(in + dim.x - 1); else DL = *(in + x - 1);
-                DM = *(in + x);
-                if( x == dim.x - 1 ) DR = *in; else DR = *(in + x + 1);
-                run_rule();  // apply rule
-                if( targeted ) {    // if targeted, compare with target
-                    if( manhattan( *tar_it, result[0] ) < manhattan( *tar_it, MM ) ) *out_it = result[0];
-                    else *out_it = MM;
-                }
-                else *out_it = result[0];
+        // Moore neighborhood runs in column stripes, Margolus family in rows of blocks.
+        // Each stripe gets its own copy of the CA so neighborhood, result and position aren't shared
+        auto run_stripes = [ & ]( int n, auto&& stripe ) {
+            int nthreads = stripe_count( n );
+            auto prepare = [ & ]( CA< T >& ca ) {
+                ca.neighbors.resize( hood == HOOD_MOORE ? 9 : 4 );
+                ca.result.resize(    hood == HOOD_MOORE ? 1 : 4 );
+                if( targeted ) ca.targ.resize( hood == HOOD_MOORE ? 1 : 4 );
+            };
+            if( nthreads <= 1 ) {
+                prepare( *this );
+                stripe( *this, 0, n );
             }
-        } 
+            else {
+                std::vector< CA< T > > workers( nthreads, *this );
+                global_pool().parallel_for( n, nthreads, [ & ]( int i0, int i1, int w ) {
+                    prepare( workers[ w ] );
+                    stripe( workers[ w ], i0, i1 );
+                } );
+            }
+        };
+
         // Margolus neighborhood family
         // Works best if image dimensions are multiples of 2
-        else if((int)hood >= (int)HOOD_MARGOLUS ){ 
-            neighbors.resize( 4 );
-            result.resize( 4 );
-            if( targeted ) targ.resize( 4 );
-            auto out_ul = out; auto out_ur = out; auto out_ll = out; auto out_lr = out;
-            auto in_ul  = in;  auto in_ur  = in;  auto in_ll  = in;  auto in_lr  = in;
-            auto tar_ul = tar; auto tar_ur = tar; auto tar_ll = tar; auto tar_lr = tar;
-            // initialize iterators
-            int startx, starty;
+        int startx = 0, starty = 0; // block offset for this frame
+        if( hood != HOOD_MOORE ) {
             if( hood == HOOD_MARGOLUS ) { 
                 if( ca_frame % 2 ) { startx = 0; starty = 0; } // even ca_frame - fits into upper left corner of image
                 else               { startx = 1; starty = -1; } // odd ca_frame - offset by 1 (initally straddles four corners of image)
@@ -248,128 +306,60 @@ template< class T > void CA< T >::operator() ( any_buffer_pair_ptr& buf, element
                 if( fair_coin( gen ) ) startx = 0; else startx = 1;  // random
                 if( fair_coin( gen ) ) starty = 0; else starty = -1;
             }
-            // scan through image by row
-            for( y = starty; y < dim.y - 1; y+=2 ) {
-                if( !startx ) { // even left edge
-                    if( y == -1 ) { // top row
-                        out_ul = out + ( dim.y - 1 ) * dim.x; out_ur = out_ul + 1; 
-                        out_ll = out;                         out_lr = out    + 1;
-
-                        in_ul  = in  + ( dim.y - 1 ) * dim.x; in_ur  = in_ul  + 1; 
-                        in_ll  = in;                          in_lr  = in     + 1;
-
-                        if( targeted ) {
-                            tar_ul = tar + ( dim.y - 1 ) * dim.x; tar_ur = tar_ul + 1; 
-                            tar_ll = tar;                         tar_lr = tar    + 1;
-                        }
-                    }
-                    else {
-                        out_ul = out + y * dim.x;       out_ur = out_ul + 1; 
-                        out_ll = out + (y + 1) * dim.x; out_lr = out_ll + 1;
-
-                        in_ul = in + y * dim.x;         in_ur = in_ul + 1; 
-                        in_ll = in + (y + 1) * dim.x;   in_lr = in_ll + 1;
-
-                        if( targeted ) {
-                            tar_ul = tar + y * dim.x;       tar_ur = tar_ul + 1; 
-                            tar_ll = tar + (y + 1) * dim.x; tar_lr = tar_ll + 1;
-                        }
-                    }
-                }
-                else { // odd left edge
-                    if( y == -1 ) { // top row, straddles corners
-                        out_ul = out + dim.y * dim.x - 1; out_ur = out + ( dim.y - 1 ) * dim.x; 
-                        out_ll = out + dim.x - 1;         out_lr = out;
-
-                        in_ul  = in  + dim.y * dim.x - 1; in_ur  = in  + ( dim.y - 1 ) * dim.x; 
-                        in_ll  = in  + dim.x - 1;         in_lr  = in;
-
-                        if( targeted ) {
-                            tar_ul = tar + dim.y * dim.x - 1; tar_ur = tar + ( dim.y - 1 ) * dim.x; 
-                            tar_ll = tar + dim.x - 1;         tar_lr = tar;
-
-                            TUL = *tar_ul; TUR = *tar_ur; TLL = *tar_ll; TLR = *tar_lr;
-                        }
-
-                        MUL = *in_ul; MUR = *in_ur; MLL = *in_ll; MLR = *in_lr;
-
-                        run_rule();  // apply rule
-                        if( targeted ) {
-                            if( manhattan( RUL, TUL ) + manhattan( RUR, TUR ) + manhattan( RLR, TLR ) + manhattan( RLL, TLL ) <
-                                manhattan( MUL, TUL ) + manhattan( MUR, TUR ) + manhattan( MLR, TLR ) + manhattan( MLL, TLL ) )
-                                 { *out_ul = RUL; *out_ur = RUR; *out_ll = RLL; *out_lr = RLR; }
-                            else { *out_ul = MUL; *out_ur = MUR; *out_ll = MLL; *out_lr = MLR; }
-                        }
-                        else *out_ul = RUL; *out_ur = RUR; *out_ll = RLL; *out_lr = RLR;
-
-                        out_ul = out + ( dim.y - 1 ) * dim.x + 1; out_ur = out + ( dim.y - 1 ) * dim.x + 2; 
-                        out_ll = out + 1;                         out_lr = out + 2;
-
-                        in_ul  = in +  ( dim.y - 1 ) * dim.x + 1; in_ur  = in  + ( dim.y - 1 ) * dim.x + 2;
-                        in_ll  = in  + 1;                         in_lr  = in  + 2;
-
-                        if( targeted ) {
-                            tar_ul = tar +  ( dim.y - 1 ) * dim.x + 1; tar_ur = tar + ( dim.y - 1 ) * dim.x + 2;
-                            tar_ll = tar + 1;                         tar_lr = tar + 2;
-
-                            TUL = *tar_ul; TUR = *tar_ur; TLL = *tar_ll; TLR = *tar_lr;
-                        }
-                    }
-                    else {
-                        out_ul = out + (y + 1) * dim.x - 1; out_ur = out + y * dim.x; 
-                        out_ll = out + (y + 2) * dim.x - 1; out_lr = out + (y + 1) * dim.x;
-
-                        in_ul = in + (y + 1) * dim.x - 1;   in_ur = in + y * dim.x;
-                        in_ll = in + (y + 2) * dim.x - 1;   in_lr = in + (y + 1) * dim.x;
-
-                        if( targeted ) {
-                            tar_ul = tar + (y + 1) * dim.x - 1; tar_ur = tar + y * dim.x; 
-                            tar_ll = tar + (y + 2) * dim.x - 1; tar_lr = tar + (y + 1) * dim.x;
-
-                            TUL = *tar_ul; TUR = *tar_ur; TLL = *tar_ll; TLR = *tar_lr;
-                        }
-
-                        MUL = *in_ul; MUR = *in_ur; MLL = *in_ll; MLR = *in_lr;
-                        run_rule();  // apply rule
-                        if( targeted ) {
-                            if( manhattan( RUL, TUL ) + manhattan( RUR, TUR ) + manhattan( RLR, TLR ) + manhattan( RLL, TLL ) <
-                                manhattan( MUL, TUL ) + manhattan( MUR, TUR ) + manhattan( MLR, TLR ) + manhattan( MLL, TLL ) )
-                                 { *out_ul = RUL; *out_ur = RUR; *out_ll = RLL; *out_lr = RLR; }
-                            else { *out_ul = MUL; *out_ur = MUR; *out_ll = MLL; *out_lr = MLR; }
-                        }
-                        else *out_ul = RUL; *out_ur = RUR; *out_ll = RLL; *out_lr = RLR;
-                        out_ul = out + y * dim.x + 1;       out_ur = out + y * dim.x + 2; 
-                        out_ll = out + (y + 1) * dim.x + 1; out_lr = out + (y + 1) * dim.x + 2;
-
-                        in_ul = in + y * dim.x + 1;         in_ur = in + y * dim.x + 2;
-                        in_ll = in + (y + 1) * dim.x + 1;   in_lr = in + (y + 1) * dim.x + 2;
-
-                        if( targeted ) {
-                            tar_ul = tar + y * dim.x + 1;         tar_ur = tar + y * dim.x + 2;
-                            tar_ll = tar + (y + 1) * dim.x + 1;   tar_lr = tar + (y + 1) * dim.x + 2;
-
-                            TUL = *tar_ul; TUR = *tar_ur; TLL = *tar_ll; TLR = *tar_lr;
+        }
+        int nbx = dim.x / 2, nby = dim.y / 2;
+
+        // Rule type is resolved once per frame, and conditions (p, edge_block, bright_block) are only compiled
+        // into the loop when one of them is active, so cells pay no indirect call or condition checks
+        bool checked = *p < 1.0f || *edge_block || *bright_block;
+        active_fraction = 1.0f;
+        std::visit( [ & ]( auto& rule_ptr ) {
+            auto& r = *rule_ptr;
+            typedef std::decay_t< decltype( r ) > U;
+            auto scan = [ & ]( auto check ) {
+                constexpr bool c = decltype( check )::value;
+                if( track_active ) {
+                    auto active = active_tiles( in, out );
+                    int tb = tile_size / 2; // tile size in Margolus blocks
+                    run_stripes( active.size(), [ & ]( CA< T >& ca, int i0, int i1 ) {
+                        for( int i = i0; i < i1; i++ ) {
+                            vec2i t = active[ i ];
+                            if( hood == HOOD_MOORE ) 
+                                ca.template run_moore< U, c >( r, in, out, tar, t.x * tile_size, std::min( ( t.x + 1 ) * tile_size, dim.x ), 
+                                                                                t.y * tile_size, std::min( ( t.y + 1 ) * tile_size, dim.y ) );
+                            else 
+                                ca.template run_margolus< U, c >( r, in, out, tar, startx, starty, std::min( t.x * tb, nbx ), std::min( ( t.x + 1 ) * tb, nbx ), 
+                                                                                                   std::min( t.y * tb, nby ), std::min( ( t.y + 1 ) * tb, nby ) );
                         }
-                    }
+                    } );
                 }
-                for( x= startx; x < dim.x; x += 2 ) {
-                    // set neighborhood
-                    MUL = *in_ul; MUR = *in_ur; MLL = *in_ll; MLR = *in_lr;
-                    if( targeted ) { TUL = *tar_ul; TUR = *tar_ur; TLL = *tar_ll; TLR = *tar_lr; }
-                    run_rule();  // apply rule
-                    *out_ul = RUL; *out_ur = RUR; *out_ll = RLL; *out_lr = RLR;
-                    // update neighborhood
-                    in_ul  += 2; in_ur  += 2; in_ll  += 2; in_lr  += 2;
-                    out_ul += 2; out_ur += 2; out_ll += 2; out_lr += 2;
-                    if( targeted ) { tar_ul += 2; tar_ur +=2 ; tar_ll +=2 ; tar_lr += 2; }
-                    if( x == dim.x - 3 ) { // right edge
-                        in_ur  -= dim.x; in_lr  -= dim.x;
-                        out_ur -= dim.x; out_lr -= dim.x;
-                        if( targeted ) { tar_ur -= dim.x; tar_lr -= dim.x; }
-                    }
+                else if( hood == HOOD_MOORE ) 
+                    run_stripes( dim.x, [ & ]( CA< T >& ca, int x0, int x1 ) { ca.template run_moore< U, c >( r, in, out, tar, x0, x1, 0, dim.y ); } );
+                else 
+                    run_stripes( nby,   [ & ]( CA< T >& ca, int by0, int by1 ) { ca.template run_margolus< U, c >( r, in, out, tar, startx, starty, 0, nbx, by0, by1 ); } );
+            };
+            // Game of Life without thresholding or per-cell conditions runs bit-sliced
+            if constexpr( std::is_same_v< U, rule_life< T > > ) {
+                if( hood == HOOD_MOORE && !r.use_threshold && !targeted && !checked ) {
+                    r.run_packed( *this, in, out );
+                    return;
                 }
             }
-        } 
+            if( checked ) scan( std::true_type() );
+            else          scan( std::false_type() );
+        }, rule.rule_ptr );
+
+        if( hood != HOOD_MOORE ) {
+            // odd dimensions leave one column or row outside the block grid - pass it through unchanged
+            if( dim.x % 2 ) {
+                int cx = ( startx + 2 * nbx ) % dim.x;
+                for( int cy = 0; cy < dim.y; cy++ ) *( out + cy * dim.x + cx ) = *( in + cy * dim.x + cx );
+            }
+            if( dim.y % 2 ) {
+                int cy = ( starty + 2 * nby + dim.y ) % dim.y;
+                std::copy( in + cy * dim.x, in + ( cy + 1 ) * dim.x, out + cy * dim.x );
+            }
+        }
         ca_frame++;
         buf_ptr->swap();
     }
@@ -394,7 +384,7 @@ template< class T > void rule_identity< T >::operator () ( CA< T >& ca ) {
  *  http://www.bitstorm.org/gameoflife/lexicon/
  */
 
-template<class T> inline rule_life<T>::rule_life() { 
+template<class T> inline rule_life<T>::rule_life() : use_threshold( false ), threshold( 384 ) { 
     T c;
     black( c );
     off = c;
@@ -430,6 +420,74 @@ template< class T > void rule_life< T >::operator () ( CA< T >& ca ) {
     }
 }
 
+// Bit-sliced Game of Life. Each row is packed into 64-bit words (on = 1, any other color = 0), then the
+// eight neighbor bits of 64 cells at a time are summed with full adders into a 3-bit count (mod 8 - zero
+// and eight neighbors both mean death). Same result as the per-cell rule, with toroidal wrap.
+template< class T > void rule_life< T >::run_packed( CA< T >& ca, typename CA< T >::const_pixel_it in, typename CA< T >::pixel_it out ) {
+    typedef unsigned long long word;
+    const vec2i dim = ca.dim;
+    const int nw = ( dim.x + 63 ) / 64;     // words per row
+    const int last_bit = ( dim.x - 1 ) % 64; // position of rightmost cell in last word
+    const word tail = last_bit == 63 ? ~0ull : ( 1ull << ( last_bit + 1 ) ) - 1;
+    const T on_c = *on, off_c = *off;
+    cells.resize( nw * dim.y );
+    int nstripes = ca.stripe_count( dim.y );
+
+    // pack - bits past the right edge stay zero
+    global_pool().parallel_for( dim.y, nstripes, [ & ]( int y0, int y1, int ) {
+        for( int y = y0; y < y1; y++ ) {
+            auto row_in = in + y * dim.x;
+            for( int i = 0; i < nw; i++ ) {
+                word w = 0;
+                int n = std::min( 64, dim.x - i * 64 );
+                for( int b = 0; b < n; b++ ) w |= (word)( *( row_in + i * 64 + b ) == on_c ) << b;
+                cells[ y * nw + i ] = w;
+            }
+        }
+    } );
+
+    // bit x of west holds cell x - 1, bit x of east holds cell x + 1, wrapping at image edges
+    auto west = [ & ]( const word* r, int i ) {
+        word w = r[ i ] << 1;
+        if( i > 0 ) w |= r[ i - 1 ] >> 63;
+        else        w |= ( r[ nw - 1 ] >> last_bit ) & 1;
+        return w;
+    };
+    auto east = [ & ]( const word* r, int i ) {
+        word w = r[ i ] >> 1;
+        if( i < nw - 1 ) w |= r[ i + 1 ] << 63;
+        else             w |= ( r[ 0 ] & 1 ) << last_bit;
+        return w;
+    };
+
+    global_pool().parallel_for( dim.y, nstripes, [ & ]( int y0, int y1, int ) {
+        for( int y = y0; y < y1; y++ ) {
+            const word* a = &cells[ ( ( y + dim.y - 1 ) % dim.y ) * nw ];  // row above
+            const word* b = &cells[ y * nw ];
+            const word* c = &cells[ ( ( y + 1 ) % dim.y ) * nw ];          // row below
+            auto row_out = out + y * dim.x;
+            for( int i = 0; i < nw; i++ ) {
+                word n0 = west( a, i ), n1 = a[ i ], n2 = east( a, i );
+                word n3 = west( b, i ),              n4 = east( b, i );
+                word n5 = west( c, i ), n6 = c[ i ], n7 = east( c, i );
+                // full adders: three ones-place sums, then their carries into the twos and fours places
+                word sa = n0 ^ n1 ^ n2, ca1 = ( n0 & n1 ) | ( n2 & ( n0 ^ n1 ) );
+                word sb = n3 ^ n4 ^ n5, cb1 = ( n3 & n4 ) | ( n5 & ( n3 ^ n4 ) );
+                word sc = n6 ^ n7,      cc1 = n6 & n7;
+                word s0 = sa ^ sb ^ sc, cd1 = ( sa & sb ) | ( sc & ( sa ^ sb ) );
+                word t  = ca1 ^ cb1 ^ cc1, ce2 = ( ca1 & cb1 ) | ( cc1 & ( ca1 ^ cb1 ) );
+                word s1 = t ^ cd1, cf2 = t & cd1;
+                word s2 = ce2 ^ cf2;
+                // alive with count 3, or count 2 and already alive
+                word next = s1 & ~s2 & ( s0 | b[ i ] );
+                if( i == nw - 1 ) next &= tail;
+                int n = std::min( 64, dim.x - i * 64 );
+                for( int k = 0; k < n; k++ ) *( row_out + i * 64 + k ) = ( next >> k ) & 1 ? on_c : off_c;
+            }
+        }
+    } );
+}
+
 template< class T > CA_hood rule_random_copy< T >::operator () ( element_context &context ) 
 { 
     return HOOD_MOORE; 
@@ -566,6 +624,7 @@ template< class T > void rule_box_blur< T >::operator () ( CA< T >& ca ) {
         }
         break;
         case BB_CUSTOM: {
+            std::array< unsigned int, 8 > diffs; // Manhattan distance to each neighbor
             diffs[ 0 ] = manhattan( MM, UM );
             diffs[ 1 ] = manhattan( MM, UR );
             diffs[ 2 ] = manhattan( MM, MR );
@@ -49,8 +49,25 @@ template< class T > struct CA {
    harness< interval_int > bright_range; // cells with brightness within range will run
    // future: image block
 
+   int threads; // worker threads for column stripes (Moore) or block rows (Margolus). 1 runs serially, 0 uses all available
+
+   // Active region tracking - only tiles that changed recently (or border one that did) are evaluated.
+   // Exact for deterministic rules with fixed parameters; random rules freeze once a tile stops changing
+   bool track_active;  // if true, settled tiles are skipped and left in place in the double buffer
+   int tile_size;      // width and height of tracked tiles in pixels (even, so Margolus blocks line up)
+   float active_fraction; // fraction of tiles evaluated last frame
+   vec2i tiles;        // number of tiles in each direction
+   std::vector< int > last_change; // ca_frame when each tile was last seen changing
+
+   typedef typename image_storage< T >::type::iterator pixel_it;
+   typedef typename image_storage< T >::type::const_iterator const_pixel_it;   // source and target are only read
+
    //void set_rule( any_rule rule );
-   void run_rule();
+   int stripe_count( int n ); // number of stripes to split n columns or rows into
+   template< class U, bool checked > void run_rule( U& r );
+   template< class U, bool checked > void run_moore( U& r, const_pixel_it in, pixel_it out, const_pixel_it tar, int x0, int x1, int y0, int y1 ); // columns x0 to x1 - 1, rows y0 to y1 - 1, toroidal
+   template< class U, bool checked > void run_margolus( U& r, const_pixel_it in, pixel_it out, const_pixel_it tar, int startx, int starty, int bx0, int bx1, int by0, int by1 ); // blocks bx0 to bx1 - 1 in block rows by0 to by1 - 1
+   std::vector< vec2i > active_tiles( const_pixel_it in, pixel_it out ); // updates last_change and lists tiles to evaluate this frame
    void operator () ( any_buffer_pair_ptr& buf, element_context& context );
 
    CA() :  // default constructor for rule returns identity rule pointer
@@ -58,12 +75,17 @@ template< class T > struct CA {
       targeted( false ),
       target( null_buffer_pair_ptr ),
       hood( HOOD_MOORE ), 
+      ca_frame(0),
       p( 1.0f ),
       edge_block( false ),
       alpha_block( false ),
       bright_block( false ),
       bright_range( { 0, 768 } ),
-      ca_frame(0) {}
+      threads( 1 ),
+      track_active( false ),
+      tile_size( 32 ),
+      active_fraction( 1.0f ),
+      tiles( 0, 0 ) {}
 };
 
 //typedef CA< frgb > CA_frgb;
@@ -90,9 +112,11 @@ template< class T > struct rule_life {
    harness< T > on, off;  // colors to represent on and off states
    bool use_threshold; // if true, use thresholding to determine on and off states
    harness< int > threshold; // threshold value
+   std::vector< unsigned long long > cells; // bit-packed rows for run_packed, one bit per cell
 
    CA_hood operator () ( element_context& context );
    void operator () ( CA< T >& ca );
+   void run_packed( CA< T >& ca, typename CA< T >::const_pixel_it in, typename CA< T >::pixel_it out ); // whole frame, 64 cells at a time
             
    rule_life( const T& on_init, const T& off_init, const bool& use_threshold_init = false, const int& threshold_init = 384 ) : on( on_init ), off( off_init ), use_threshold( use_threshold_init ), threshold( threshold_init ) {}
    rule_life();
@@ -141,7 +165,6 @@ template< class T > struct rule_box_blur {
    harness< box_blur_type > blur_method; // Type of box blur
    harness< bool > bug_mode; // if true, return default color if no neighbors are within max_diff
    harness< bool > random_copy; // if true, randomly copy color from a neighbor instead of blurring
-   std::array< unsigned int, 8 > diffs; // Manhattan distance to each neighbor
 
    //harness< int > dirs_size; // number of directions
    //std::vector< harness < int > > dirs;  // array of directions for blur
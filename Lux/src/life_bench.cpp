@@ -0,0 +1,75 @@
+#include "life.hpp"
+#include "scene.hpp"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+// Times every CA rule on a random image. "frame" is a full CA step as run by lux. "function" and "direct"
+// call the rule on a fixed neighborhood through the type-erased any_rule and through the concrete rule type,
+// which shows the per-cell dispatch cost removed by resolving the rule once per frame. With track_active set,
+// "active" is the fraction of tiles still being evaluated on the last frame.
+// Usage: ./life_bench [size] [frames] [threads] [track_active]
+
+template< class R > void bench( const std::string& name, std::shared_ptr< R > r, int size, int frames, int threads, bool track_active ) {
+    typedef std::chrono::steady_clock clock;
+    auto ms = []( clock::time_point a, clock::time_point b ) { return std::chrono::duration< double, std::milli >( b - a ).count(); };
+
+    vec2i dim( size, size );
+    image< ucolor > img( dim );
+    for( auto it = img.begin(); it != img.end(); ++it ) *it = 0xff000000 | ( rand_uint( gen ) & 0x00ffffff );
+    any_buffer_pair_ptr buf = std::make_shared< buffer_pair< ucolor > >( img );
+
+    CA< ucolor > ca;
+    ca.rule = any_rule( r, std::ref( *r ), std::ref( *r ), name );
+    ca.threads = threads;
+    ca.track_active = track_active;
+    scene s;
+    element el;
+    next_element ne;
+    cluster cl( el, ne );
+    element_context context( el, cl, s, buf );
+    ca( buf, context ); // first frame only initializes
+
+    auto t0 = clock::now();
+    for( int i = 0; i < frames; i++ ) ca( buf, context );
+    auto t1 = clock::now();
+
+    // per-cell dispatch on a fixed neighborhood
+    ca.neighbors.assign( 9, 0xff808080 );
+    ca.result.resize( 4 );
+    int cells = size * size;
+    auto t2 = clock::now();
+    for( int i = 0; i < cells; i++ ) { ca.neighbors[ 0 ] = i; ca.rule( ca ); }
+    auto t3 = clock::now();
+    for( int i = 0; i < cells; i++ ) { ca.neighbors[ 0 ] = i; ( *r )( ca ); }
+    auto t4 = clock::now();
+
+    std::cout << std::left << std::setw( 18 ) << name << std::right << std::fixed << std::setprecision( 2 )
+              << std::setw( 10 ) << ms( t0, t1 ) / frames << " ms/frame"
+              << std::setw( 10 ) << ms( t2, t3 ) << " ms function"
+              << std::setw( 10 ) << ms( t3, t4 ) << " ms direct";
+    if( track_active ) std::cout << std::setw( 10 ) << ca.active_fraction << " active";
+    std::cout << std::endl;
+}
+
+int main( int argc, char** argv ) {
+    int size = 1024, frames = 10, threads = 1;
+    bool track_active = false;
+    if( argc > 1 ) std::stringstream( argv[ 1 ] ) >> size;
+    if( argc > 2 ) std::stringstream( argv[ 2 ] ) >> frames;
+    if( argc > 3 ) std::stringstream( argv[ 3 ] ) >> threads;
+    if( argc > 4 ) std::stringstream( argv[ 4 ] ) >> track_active;
+    std::cout << size << "x" << size << ", " << frames << " frames, threads " << threads << std::endl;
+
+    bench( "identity",    std::make_shared< rule_identity_ucolor    >(), size, frames, threads, track_active );
+    bench( "life",        std::make_shared< rule_life_ucolor        >(), size, frames, threads, track_active );
+    bench( "random_copy", std::make_shared< rule_random_copy_ucolor >(), size, frames, threads, track_active );
+    bench( "random_mix",  std::make_shared< rule_random_mix_ucolor  >(), size, frames, threads, track_active );
+    bench( "box_blur",    std::make_shared< rule_box_blur_ucolor    >(), size, frames, threads, track_active );
+    bench( "diffuse",     std::make_shared< rule_diffuse_ucolor     >(), size, frames, threads, track_active );
+    bench( "gravitate",   std::make_shared< rule_gravitate_ucolor   >(), size, frames, threads, track_active );
+    bench( "snow",        std::make_shared< rule_snow_ucolor        >(), size, frames, threads, track_active );
+    bench( "pixel_sort",  std::make_shared< rule_pixel_sort_ucolor  >(), size, frames, threads, track_active );
+    bench( "funky_sort",  std::make_shared< rule_funky_sort_ucolor  >(), size, frames, threads, track_active );
+    return 0;
+}
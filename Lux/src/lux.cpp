@@ -10,10 +10,12 @@
 #include "scene.hpp"
 #include "warp.hpp"
 #include "life.hpp"
+#include "image_cache.hpp"
 
 #include <sstream>
 #include <string>
 #include <iomanip>
+#include <cstdlib>
 
 void render( std::string scene_filename, std::string file_out, vec2i dim = { 512, 512 } ) {
     scene s( scene_filename );
@@ -30,15 +32,34 @@ void animate( std::string scene_filename, std::string basename, int nframes ) {
     //std::cout << "Render complete " << basename << std::endl;
 }
 
+void stream( std::string scene_filename, std::string filename, int nframes ) {
+    scene s( scene_filename );
+    s.stream( filename, nframes, { 512, 512 }, stream_format_for( filename ) );
+}
+
 int main( int argc, char** argv ) {
     if( argc < 3 ) {
         std::cout << "Usage: ./lux file_in file_out [nframes]\n";
+        std::cout << "       file_out ending .y4m, .rgba or .pngs streams every frame into that file, - streams Y4M to stdout\n";
+        std::cout << "       LUX_IMAGE_CACHE=dir keeps decoded source images in dir for later runs\n";
         return 0;
     }
     std::string scene_filename(  argv[ 1 ] );
     std::string output_name( argv[ 2 ] );
     
-    if( argc == 3 ) render( scene_filename, output_name /*, { 3648, 3648 } */);
+    bool streaming = is_stream_name( output_name );
+    if( output_name == "-" ) std::cout.rdbuf( std::cerr.rdbuf() );  // keep progress messages out of the frames
+    if( const char* dir = std::getenv( "LUX_IMAGE_CACHE" ) ) {
+        global_image_cache< frgb   >().set_disk_dir( dir );
+        global_image_cache< ucolor >().set_disk_dir( dir );
+    }
+
+    if( streaming ) {
+        int nframes = 1;
+        if( argc > 3 ) std::stringstream( argv[ 3 ] ) >> nframes;
+        stream( scene_filename, output_name, nframes );
+    }
+    else if( argc == 3 ) render( scene_filename, output_name /*, { 3648, 3648 } */);
     else {
         int nframes;
         std::stringstream ss( argv[ 3 ] );
@@ -31,4 +31,5 @@ template<> void offset_field::fill(const image< vec2f >& vfield, const bool rela
             }
         }
     }
+    mark_dirty();
 }
@@ -6,27 +6,29 @@
 #include "warp_field.hpp"
 #include "offset_field.hpp"
 #include "scene_io.hpp"
+#include "thread_pool.hpp"
+#include "frame_writer.hpp"
 #include <optional>
 #include <sstream>
 
 #define SCENE_DEBUG
 
 // splats any element onto a particular image
-template< class T > void splat_element( std::shared_ptr< buffer_pair< T > > target_buf, element& el ) {
+template< class T > void splat_element( std::shared_ptr< buffer_pair< T > > target_buf, element& el, any_splat_batch& batch ) {
     typedef std::shared_ptr< buffer_pair< T > > buf_ptr;  
 
     if( std::holds_alternative< buf_ptr >( el.img ) ) { // Check if element image is same type as target. Otherwise no effect. Future - splat image of different type.
         buf_ptr img_buf  = std::get< buf_ptr >( el.img ); 
         if( img_buf.get() ) {                // Check if buffer pair null   
             if( img_buf->has_image() ) {
-                std::optional< std::reference_wrapper< image< T > > > mask = std::nullopt;
+                std::optional< std::reference_wrapper< const image< T > > > mask = std::nullopt;
                 std::optional< T > tint = std::nullopt;
 
                 if( std::holds_alternative< buf_ptr >( el.mask ) ) {
                     buf_ptr mask_buf = std::get< buf_ptr >( el.mask );
                     if( mask_buf.get() ) {
                         if( mask_buf->has_image() ) {
-                            mask = std::ref( mask_buf->get_image() );
+                            mask = std::cref( mask_buf->read_image() );
                         }
                     }
                 }
@@ -36,9 +38,12 @@ template< class T > void splat_element( std::shared_ptr< buffer_pair< T > > targ
                 float th = el.rotation;
                 if( el.orientation_lock ) th += el.orientation;
 
-                if( target_buf->has_image() ) {
+                if( std::holds_alternative< splat_batch< T >* >( batch ) ) {
+                    std::get< splat_batch< T >* >( batch )->add( img_buf->read_image(), false, el.position, el.scale, th, mask, tint, el.mmode );
+                }
+                else if( target_buf->has_image() ) {
 //                    target_buf->get_image().splat( img_buf->get_image(), el.smooth, el.position, el.scale, th, mask, tint, el.mmode ); 
-                    target_buf->get_image().splat( img_buf->get_image(), false, el.position, el.scale, th, mask, tint, el.mmode ); 
+                    target_buf->get_image().splat( img_buf->read_image(), false, el.position, el.scale, th, mask, tint, el.mmode ); 
                 }
             }
             else std::cout << "splat_element() - no image in buffer" << std::endl;
@@ -49,16 +54,16 @@ template< class T > void splat_element( std::shared_ptr< buffer_pair< T > > targ
 }
 
 // splats any element onto any image
-void element::render( any_buffer_pair_ptr& target ) { 
+void element::render( any_buffer_pair_ptr& target, any_splat_batch batch ) { 
     //std::cout << " element::render\n";
     pixel_type ptype = ( pixel_type )target.index();
     //std::cout << " pixel type " << ptype << std::endl;
     switch( ( pixel_type )target.index() ) {     // replace with std::visit
-        case( PIXEL_FRGB   ): splat_element< frgb   >( std::get< std::shared_ptr< buffer_pair< frgb > > >( target ), *this ); break;
-        case( PIXEL_UCOLOR ): splat_element< ucolor >( std::get< std::shared_ptr< buffer_pair< ucolor > > >( target ), *this ); break;
-        case( PIXEL_VEC2F  ): splat_element< vec2f  >( std::get< std::shared_ptr< buffer_pair< vec2f > > >( target ), *this ); break;
-        case( PIXEL_INT    ): splat_element< int    >( std::get< std::shared_ptr< buffer_pair< int > > >( target ), *this ); break;
-        case( PIXEL_VEC2I  ): splat_element< vec2i  >( std::get< std::shared_ptr< buffer_pair< vec2i > > >( target ), *this ); break;
+        case( PIXEL_FRGB   ): splat_element< frgb   >( std::get< std::shared_ptr< buffer_pair< frgb > > >( target ), *this, batch ); break;
+        case( PIXEL_UCOLOR ): splat_element< ucolor >( std::get< std::shared_ptr< buffer_pair< ucolor > > >( target ), *this, batch ); break;
+        case( PIXEL_VEC2F  ): splat_element< vec2f  >( std::get< std::shared_ptr< buffer_pair< vec2f > > >( target ), *this, batch ); break;
+        case( PIXEL_INT    ): splat_element< int    >( std::get< std::shared_ptr< buffer_pair< int > > >( target ), *this, batch ); break;
+        case( PIXEL_VEC2I  ): splat_element< vec2i  >( std::get< std::shared_ptr< buffer_pair< vec2i > > >( target ), *this, batch ); break;
     }
 }
 
@@ -66,12 +71,26 @@ void element::operator () ( any_buffer_pair_ptr& buf, element_context& context )
     render( buf );
 }
 
+// generate the whole tree first, recording splats, then draw them tile by tile
+template< class T > void render_deferred( cluster& cl, scene& s, any_buffer_pair_ptr& buf, std::shared_ptr< buffer_pair< T > >& target_buf ) {
+    if( !target_buf.get() || !target_buf->has_image() ) return;
+    splat_batch< T > batch( target_buf->get_image(), 256, cl.threads );
+    cl.batch = &batch;
+    cl.render( s, buf );
+    cl.batch = std::monostate();
+    batch.draw();
+}
+
 // Recursively generate and render elements
 void cluster::render( scene& s, any_buffer_pair_ptr& buf ) { 
+    if( ( deferred || threads != 1 ) && std::holds_alternative< std::monostate >( batch ) ) {
+        std::visit( [&]( auto& target_buf ) { render_deferred( *this, s, buf, target_buf ); }, buf );
+        return;
+    }
     element el = root_elem;
     element_context context( el, *this, s, buf );
     max_n( context ); min_scale( context ); max_depth( context ); // set cluster harnesses
-    while( next_elem( context ) ) el.render( buf ); 
+    while( next_elem( context ) ) el.render( buf, batch ); 
     
     //( ( fimage & )img ).write_jpg( "hk_cluster.jpg", 100 ); // debug - save frame after each cluster                   
 }
@@ -115,19 +134,22 @@ void effect_list::update_source_name( scene& s ) {
 }
 
 void effect_list::copy_source_buffer( scene& s ) {
+    std::visit( [&]( auto& b ) { b->set_pool( s.pools ); }, buf );
     // get dimensions of source buffer - resize output buffer if necessary
         if( rmode == MODE_EPHEMERAL || !rendered ) { // ephemeral buffers are re-rendered each frame
         std::cout << "preparing to copy buffer " << *source_name << std::endl;
-        if( s.buffers.contains( *source_name ) ) {  // load source image or result into buffer
-            // Copy source buffer into working buffer 
-            any_buffer_pair_ptr& source_buf = s.buffers[ *source_name ];
+        // find() rather than operator[] - lists in one stage run this at the same time
+        auto source_it = s.buffers.find( *source_name );
+        if( source_it != s.buffers.end() ) {  // load source image or result into buffer
+            // Borrow source image - copied only when an effect writes to it
+            any_buffer_pair_ptr& source_buf = source_it->second;
             vec2i source_dim;
-            std::visit( [&]( auto& b ) { source_dim = b->get_image().get_dim(); }, source_buf );
+            std::visit( [&]( auto& b ) { source_dim = b->read_image().get_dim(); }, source_buf );
             if( source_dim != dim ) {
                 dim = source_dim;
                 resize( dim );
             }
-            std::visit( [ &, source_buf ]( auto& b ) { copy_buffer( b, source_buf ); }, buf );
+            std::visit( [ &, source_buf ]( auto& b ) { borrow_buffer( b, source_buf ); }, buf );
         }
         else {  // blank buffer
             //throw std::runtime_error( "effect_list::render() - source buffer not found" );
@@ -150,7 +172,9 @@ void effect_list::render( scene& s ) {
             next_element default_next_element;
             cluster default_cluster( default_element, default_next_element );
             element_context context( default_element, default_cluster, s, buf );
-            s.effects[ e ]( buf, context );
+            auto eff = s.effects.find( e );
+            if( eff == s.effects.end() ) throw std::runtime_error( "effect_list::render() - effect " + e + " not found" );
+            eff->second( buf, context );
             //std::cout << "rendered effect " << e << " into buffer " << name << std::endl;
         }
         rendered = true;
@@ -164,10 +188,10 @@ void effect_list::restart( scene& s ) {
     copy_source_buffer( s );
 }
 
-scene::scene( float time_interval_init ) : time_interval( time_interval_init ), default_time_interval( time_interval_init ) {}
+scene::scene( float time_interval_init ) : time_interval( time_interval_init ), default_time_interval( time_interval_init ), threads( 1 ) {}
 
 scene::scene( const std::string& filename, float time_interval_init ) 
-    : time( 0.0f ), time_interval( time_interval_init ), default_time_interval( time_interval_init )
+    : time( 0.0f ), time_interval( time_interval_init ), default_time_interval( time_interval_init ), threads( 1 )
 {
     scene_reader reader( *this, filename );
 }
@@ -191,7 +215,16 @@ void scene::set_time_interval( const float& t ) {
 
 void scene::render() {
     //std::cout << "scene::render() " << std::endl;
-    for( auto& eff_list : queue ) eff_list.render( *this );
+    // stages no longer cover the queue if it was changed after loading
+    size_t staged = 0;
+    for( auto& stage : stages ) staged += stage.size();
+    if( threads == 1 || staged != queue.size() ) for( auto& eff_list : queue ) eff_list.render( *this );
+    else for( auto& stage : stages ) {
+        int n = stage.size();
+        global_pool().parallel_for( n, threads ? std::min( n, threads ) : n, [&]( int begin, int end, int ) {
+            for( int i = begin; i < end; i++ ) queue[ stage[ i ] ].render( *this );
+        } );
+    }
     time += time_interval;
 }
 
@@ -224,15 +257,8 @@ void scene::render_and_save(
     int quality )
 { 
     //std::cout << "scene::render_and_save() dim = " << dim.x << " " << dim.y << std::endl;
-    any_buffer_pair_ptr any_out;
     // bounds set automatically by image constructor
-    switch( ptype ) {
-        case( PIXEL_FRGB   ): any_out = std::make_shared< buffer_pair< frgb >   >( dim ); break;
-        case( PIXEL_UCOLOR ): any_out = std::make_shared< buffer_pair< ucolor > >( dim ); break;
-        case( PIXEL_VEC2F  ): any_out = std::make_shared< buffer_pair< vec2f >  >( dim ); break;
-        case( PIXEL_INT    ): any_out = std::make_shared< buffer_pair< int >    >( dim ); break;
-        case( PIXEL_VEC2I  ): any_out = std::make_shared< buffer_pair< vec2i >  >( dim ); break;
-    }
+    any_buffer_pair_ptr any_out = pooled_buffer( dim, ptype );
     set_output_buffer( any_out ); // set output buffer
     render(); // render into image
     save_result( filename, dim, ptype, ftype, quality ); // save image
@@ -244,33 +270,69 @@ void scene::animate(
     vec2i dim,
     pixel_type ptype, 
     file_type ftype, 
-    int quality )
+    int quality,
+    int writers )
 {
     //std::cout << "scene::animate() dim = " << dim.x << " " << dim.y << std::endl;
+    if( writers < 0 ) throw std::runtime_error( "scene::animate: negative number of writers" );
 
-    any_buffer_pair_ptr any_out;
-    switch( ptype ) {
-        case( PIXEL_FRGB   ): any_out = std::make_shared< buffer_pair< frgb >   >( dim ); break;
-        case( PIXEL_UCOLOR ): any_out = std::make_shared< buffer_pair< ucolor > >( dim ); break;
-        case( PIXEL_VEC2F  ): any_out = std::make_shared< buffer_pair< vec2f >  >( dim ); break;
-        case( PIXEL_INT    ): any_out = std::make_shared< buffer_pair< int >    >( dim ); break;
-        case( PIXEL_VEC2I  ): any_out = std::make_shared< buffer_pair< vec2i >  >( dim ); break;
-    }
+    any_buffer_pair_ptr any_out = pooled_buffer( dim, ptype );
     set_output_buffer( any_out ); // set output buffer
 
+    // each frame is copied out of the output buffer for its writer
+    frame_writer writer( writers, 2 * writers );
+
     time = 0.0f;
     for( int frame = 0; frame < nframes; frame++ ) {
         std::ostringstream s;
         s << basename << std::setfill('0') << std::setw(4) << frame << ".jpg";
         std::string filename = s.str();
         render();
-        save_result( filename, dim, ptype, ftype, quality );
+        if( writers ) {
+            auto img = copy_result();
+            writer.submit( [ img, filename, quality ] { img->write_jpg( filename, quality ); } );
+        }
+        else save_result( filename, dim, ptype, ftype, quality );
         std::cout << "frame " << frame << " time " << time << std::endl;
     }
+    writer.finish();
 
     // future: make the video file here 
 }
 
+void scene::stream( 
+    const std::string& filename, 
+    int nframes, 
+    vec2i dim,
+    stream_format format, 
+    int fps )
+{
+    any_buffer_pair_ptr any_out = pooled_buffer( dim, PIXEL_UCOLOR );
+    set_output_buffer( any_out ); // set output buffer
+
+    // a single writer keeps frames in order. Declared after the stream so it finishes first
+    frame_stream out( filename, format, fps );
+    frame_writer writer( 1, 2 );
+
+    time = 0.0f;
+    for( int frame = 0; frame < nframes; frame++ ) {
+        render();
+        auto img = copy_result();
+        writer.submit( [ img, &out ] { out.write( *img ); } );
+        std::cout << "frame " << frame << " time " << time << std::endl;
+    }
+    writer.finish();
+}
+
+// temporary - assumes result type uimage, as save_result() does
+std::shared_ptr< image< ucolor > > scene::copy_result() {
+    auto out = std::get< ubuf_ptr >( queue.back().buf );
+    if( !out->has_image() ) throw std::runtime_error( "scene::copy_result: no image to copy" );
+    auto pool = pools.get< ucolor >();
+    return std::shared_ptr< uimage >( pool->take( out->read_image() ).release(), 
+        [ pool ]( uimage* i ) { std::unique_ptr< uimage > p( i ); pool->give( p ); } );
+}
+
 void scene::set_output_buffer( any_buffer_pair_ptr& buf ) {
     auto& output_list = queue.back();
     output_list.buf = buf;
@@ -281,12 +343,28 @@ void scene::set_output_buffer( any_buffer_pair_ptr& buf ) {
 
     for( int i = 0; i < queue.size() - 1; i++ ) {
         auto& eff_list = queue[ i ];
+        std::visit( [&]( auto& b ) { b->set_pool( pools ); }, eff_list.buf );
         eff_list.rendered = false;
         vec2i dim = { std::round( dim_out.x * eff_list.relative_dim ), std::round( dim_out.y * eff_list.relative_dim ) };
         eff_list.resize( dim );
     }
 }
 
+// The previous output pair hands its images back when it is replaced, so repeated calls settle into reusing them
+any_buffer_pair_ptr scene::pooled_buffer( const vec2i& dim, pixel_type ptype ) {
+    any_buffer_pair_ptr any_out;
+    switch( ptype ) {
+        case( PIXEL_FRGB   ): any_out = std::make_shared< buffer_pair< frgb >   >(); break;
+        case( PIXEL_UCOLOR ): any_out = std::make_shared< buffer_pair< ucolor > >(); break;
+        case( PIXEL_VEC2F  ): any_out = std::make_shared< buffer_pair< vec2f >  >(); break;
+        case( PIXEL_INT    ): any_out = std::make_shared< buffer_pair< int >    >(); break;
+        case( PIXEL_VEC2I  ): any_out = std::make_shared< buffer_pair< vec2i >  >(); break;
+    }
+    vec2i d = dim;
+    std::visit( [&]( auto& b ) { b->set_pool( pools ); b->reset( d ); }, any_out );
+    return any_out;
+}
+
 effect_list& scene::get_effect_list( const std::string& name ) {
     for( auto& eff_list : queue )
         if( eff_list.name == name )
@@ -6,17 +6,22 @@
 #include <optional>
 #include "buffer_pair.hpp"
 #include "any_image.hpp"
+#include "splat_batch.hpp"
 #include "effect.hpp"
 #include "next_element.hpp"
 #include "any_function.hpp"
 #include "any_rule.hpp"
 #include "UI.hpp"
+#include "frame_stream.hpp"
 
 //template< class T > struct effect;
 struct element;
 struct cluster;
 struct scene;
 
+// batch that a deferred cluster records its splats into - monostate when splatting immediately
+typedef std::variant< std::monostate, splat_batch< frgb >*, splat_batch< ucolor >*, splat_batch< vec2f >*, splat_batch< int >*, splat_batch< vec2i >* > any_splat_batch;
+
 struct element_context {
     element& el;
     cluster& cl;
@@ -49,7 +54,7 @@ struct element {
     vec2f derivative;   // move to element_context?
     bool derivative_lock;
 
-    void render( any_buffer_pair_ptr& target );
+    void render( any_buffer_pair_ptr& target, any_splat_batch batch = std::monostate() ); // splat now, or record into batch
     void operator () ( any_buffer_pair_ptr& buf, element_context& context );    // single element effect
 
     // needed?
@@ -110,6 +115,9 @@ struct cluster {
     harness< int > max_depth;      // prevent infinite recursion by limiting depth of tree
     harness< float > min_scale;    // prevent infinite recursion by limiting scale of elements
     bool background_dependent;     // if true, cluster will double buffer on rendering
+    bool deferred;                 // if true, record the whole tree of splats, then draw them tile by tile
+    int threads;                   // draw tiles in parallel (implies deferred). 1 runs serially, 0 uses all available
+    any_splat_batch batch;         // set while a deferred cluster is recording - shared with branches
 
     // Recursively generate branches and render elements
     void render( scene& s, any_buffer_pair_ptr& img );
@@ -136,16 +144,24 @@ struct cluster {
           max_n( max_n_init ),
           depth( depth_init ),
           max_depth( max_depth_init ),
-          background_dependent( background_dependent_init )
+          min_scale( 0.0f ),
+          background_dependent( background_dependent_init ),
+          deferred( false ),
+          threads( 1 )
           {}
 
     // copy constructor
     cluster( const cluster& cl ) :  
         root_elem( cl.root_elem ),
         next_elem( cl.next_elem ),
+        max_n( cl.max_n ),
         depth( cl.depth ),
         max_depth( cl.max_depth ),
-        background_dependent( cl.background_dependent )
+        min_scale( cl.min_scale ),
+        background_dependent( cl.background_dependent ),
+        deferred( cl.deferred ),
+        threads( cl.threads ),
+        batch( cl.batch )
         {}        
 };
 
@@ -210,11 +226,14 @@ struct scene {
     std::unordered_map< std::string, any_effect_fn > effects;
 
     std::unordered_map< std::string, any_buffer_pair_ptr > buffers; // Source images and results of effect stacks
+    image_pools pools;  // spare images for effect list and output buffers, reused when sizes change
     std::vector< effect_list > queue; // list of buffers rendered in order of execution
+    std::vector< std::vector< int > > stages; // queue indices grouped so lists only depend on earlier stages (see scene_reader::plan_stages)
 
     float time; 
     float time_interval; 
     float default_time_interval;
+    int threads;    // render lists within a stage in parallel. 1 runs serially, 0 uses all available
     
     float aspect;   // aspect ratio of output buffer
         
@@ -256,6 +275,7 @@ struct scene {
     void set_time_interval( const float& t );   // Set time interval for animation
  // void resize( const vec2i& dim );            // Resize all buffers in render list
     void set_output_buffer( any_buffer_pair_ptr& buf ); // Set output buffer for rendering (needed?)
+    any_buffer_pair_ptr pooled_buffer( const vec2i& dim, pixel_type ptype ); // blank buffer pair borrowing from pools
     effect_list& get_effect_list( const std::string& name ); // get effect list by name
 
     void render();  // Render scene on any image type
@@ -277,15 +297,29 @@ struct scene {
         int quality = 100 
     );          
 
+    // Writers encode and save frames in the background while the next ones render, with up to two frames 
+    // per writer waiting. 0 writes each frame before rendering the next - negative throws
     void animate( 
         std::string basename, 
         int nframes = 100, 
         vec2i dim = { 512, 512 },
         pixel_type ptype = PIXEL_UCOLOR, 
         file_type ftype = FILE_JPG, 
-        int quality = 100   
+        int quality = 100,
+        int writers = 2
     );
 
+    // Render nframes into a single stream (see frame_stream.hpp) - "-" streams to stdout
+    void stream( 
+        const std::string& filename,
+        int nframes = 100,
+        vec2i dim = { 512, 512 },
+        stream_format format = STREAM_Y4M,
+        int fps = 30
+    );
+
+    std::shared_ptr< image< ucolor > > copy_result();   // copy of output image borrowed from pool, returned when released
+
 };
 
 
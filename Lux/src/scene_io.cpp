@@ -4,9 +4,11 @@
 #include "fimage.hpp"
 #include "uimage.hpp"
 #include "vector_field.hpp"
+#include "image_cache.hpp"
 #include "UI.hpp"
 #include <fstream>
 #include <sstream>
+#include <set>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -53,6 +55,7 @@ scene_reader::scene_reader( scene& s_init, std::string( filename ) ) : s( s_init
     if( j.contains( "name" ) ) j[ "name" ].get_to( s.name ); else s.name = "Unnamed";
     DEBUG( "Name: " + s.name )
     if( j.contains( "time_interval" ) ) j[ "time_interval" ].get_to( s.time_interval );
+    if( j.contains( "threads" ) ) j[ "threads" ].get_to( s.threads );
 
     // TODO: Allow size different from image size
     //if( j.contains( "size" ) ) s.size = read_vec2i( j[ "size" ] ); else s.size = { 1080, 1080 };
@@ -77,6 +80,8 @@ scene_reader::scene_reader( scene& s_init, std::string( filename ) ) : s( s_init
         s.queue.push_back( eff_list );              // add to render queue
         s.buffers[ eff_list.name ] = eff_list.buf;  // add to buffer map
     }
+    plan_stages();
+    DEBUG( "Render graph has " + std::to_string( s.stages.size() ) + " stages for " + std::to_string( s.queue.size() ) + " effect lists" )
 
     if( j.contains( "widget groups" ) ) for( auto& wg : j[ "widget groups" ] ) read_widget_group( wg );
     DEBUG( "Widget groups loaded" )
@@ -277,14 +282,15 @@ void scene_reader::read_image( const json& j ) {
 
     // future: add binary file format for all image types
 
+    // decoded images are shared across scene loads - each buffer gets its own copy
     if( type == "fimage" ) {
-        fbuf_ptr img( new buffer_pair< frgb >( filename ) );
+        fbuf_ptr img( new buffer_pair< frgb >( *global_image_cache< frgb >().get( filename ) ) );
         s.buffers[ name ] = img;
     }
 
     if( type == "uimage" ) {
         DEBUG( "scene_reader::read_image - reading uimage" )
-        ubuf_ptr img( new buffer_pair< ucolor >( filename ) );
+        ubuf_ptr img( new buffer_pair< ucolor >( *global_image_cache< ucolor >().get( filename ) ) );
         s.buffers[ name ] = img;
         //std :: cout << "uimage pointer " << img << std::endl;
         //s.buffers[ name ] = std::make_shared< buffer_pair< ucolor > >( filename );
@@ -298,6 +304,7 @@ void scene_reader::read_element( const json& j ) {
     // If no image, element not rendered, serves as placeholder
 
     if( j.contains( "name" ) ) j[ "name" ].get_to( name );  else ERROR( "Element name missing\n" )
+    record_refs( name, j );
     s.elements[ name ] = std::make_shared< element >();
     element& elem = *(s.elements[ name ]);
 
@@ -385,6 +392,7 @@ void scene_reader::read_function( const json& j ) {
     std::string name, type, fn_name;
 
     if( j.contains( "name" ) ) j[ "name" ].get_to( name );  else ERROR( "Function name missing\n" )
+    record_refs( name, j );
     if( j.contains( "type" ) ) j[ "type" ].get_to( type );  else ERROR( "Function type missing\n" );
 
     DEBUG( "scene_reader::read_function - name: " + name + " type: " + type )
@@ -563,6 +571,7 @@ void scene_reader::read_cluster( const json& j ) {
     if( j.contains( "name" ) )          j[ "name" ].get_to( name );  else ERROR( "Cluster name missing\n" )
     // Check for unique name. Future - make sure duplicate clusters refer to the same cluster
     if( s.clusters.contains( name ) )   ERROR( "Cluster name collision\n" )
+    record_refs( name, j );
     if( j.contains( "element" ) )     j[ "element" ].get_to( root_elem_name ); else ERROR( "Cluster root_elem missing\n" )
 
     // create cluster object
@@ -575,6 +584,8 @@ void scene_reader::read_cluster( const json& j ) {
     if( j.contains( "max_depth" ) )  read_any_harness( j[ "max_depth" ], clust.max_depth );
     if( j.contains( "min_scale" ) )  read_any_harness( j[ "min_scale" ], clust.min_scale );
     if( j.contains( "max_n" ) )      read_any_harness( j[ "max_n"     ], clust.max_n );
+    if( j.contains( "deferred" ) )   j[ "deferred" ].get_to( clust.deferred );
+    if( j.contains( "threads" ) )    j[ "threads"  ].get_to( clust.threads );
     if( j.contains( "functions" ) )  for( std::string fname : j[ "functions"  ] ) clust.next_elem.add_function(  std::get< any_gen_fn       >( s.functions[ fname ] ) ); 
     if( j.contains( "conditions" ) ) for( std::string fname : j[ "conditions" ] ) clust.next_elem.add_condition( std::get< any_condition_fn >( s.functions[ fname ] ) ); 
 }
@@ -614,6 +625,7 @@ void scene_reader::read_effect( const json& j ) {
     // Check for unique name. Future - make sure duplicate effects refer to the same effect
 
     if( s.effects.contains( name ) )   ERROR( "Effect name collision\n" )
+    record_refs( name, j );
 
     #define EFF( _T_ )     if( type == #_T_ ) {  std::shared_ptr< _T_ > e( new _T_ ); any_effect_fn eff( e, std::ref( *( e.get() ) ), name );
     #define HARNESSE( _T_ ) if( j.contains( #_T_ ) ) read_any_harness( j[ #_T_ ], e-> _T_ );
@@ -654,7 +666,7 @@ void scene_reader::read_effect( const json& j ) {
             j[ "target" ].get_to( buf_name );
             CA_targets[ name ] = buf_name;
         }
-        READE( targeted )
+        READE( targeted ) READE( threads ) READE( track_active ) READE( tile_size )
         HARNESSE( p ) HARNESSE( edge_block ) HARNESSE( alpha_block ) 
         HARNESSE( bright_block ) HARNESSE( bright_range )
     END_EFF()
@@ -774,7 +786,8 @@ void scene_reader::read_effect( const json& j ) {
                                HARNESSE( min_soften ) HARNESSE( max_soften )
                                HARNESSE( min_intensity ) HARNESSE( max_intensity ) READE( intensity_direction )
                                READE( revolving ) HARNESSE( min_velocity ) HARNESSE( max_velocity )
-                               READE( velocity_direction ) HARNESSE( min_orbital_radius ) HARNESSE( max_orbital_radius ) END_EFF()
+                               READE( velocity_direction ) HARNESSE( min_orbital_radius ) HARNESSE( max_orbital_radius ) 
+                               READE( cache ) READE( cache_phases ) READE( cache_mb ) END_EFF()
     EFF( eff_position_fill_vec2f ) END_EFF()
 
     // warp field effects
@@ -800,6 +813,56 @@ void scene_reader::read_queue( const json& j, effect_list& elist ) {
     if( j.contains( "relative_dim" ) ) read( elist.relative_dim,   j[ "relative_dim" ] );  
     if( j.contains( "mode"         ) ) read( elist.rmode,          j[ "mode"         ] );
     if( j.contains( "type"         ) ) read( elist.ptype,          j[ "type"         ] );
+
+    // a source chosen by function could be any buffer, so the list renders on its own
+    bool alone = j.contains( "source" ) && j[ "source" ].is_object() && j[ "source" ].contains( "functions" );
+    for( auto& e : elist.effects ) if( !s.effects.contains( e ) ) alone = true;
+    queue_refs.push_back( { { *elist.source_name }, alone } );
+    for( auto& e : elist.effects ) queue_refs.back().first.push_back( e );
+}
+
+// every string in j, wherever it is - names of buffers, effects, functions, elements and clusters among them
+void scene_reader::record_refs( const std::string& name, const json& j ) {
+    std::vector< std::string >& r = refs[ name ];
+    std::function< void ( const json& ) > scan = [ & ]( const json& k ) {
+        if( k.is_string() ) r.push_back( k.get< std::string >() );
+        else if( k.is_structured() ) for( auto& v : k ) scan( v );
+    };
+    scan( j );
+}
+
+// Two lists conflict if one reads the other's buffer (in either direction, so last frame's result is still read 
+// before it is replaced) or both use the same effect, function, element or cluster, which carry state between calls.
+// Buffers that both only read are shared. Each list goes in the stage after the last one holding a conflicting list.
+void scene_reader::plan_stages() {
+    int n = s.queue.size();
+    std::vector< std::set< std::string > > reach( n );
+    for( int i = 0; i < n; i++ ) {
+        std::vector< std::string > todo = queue_refs[ i ].first;
+        while( todo.size() ) {
+            std::string name = todo.back();
+            todo.pop_back();
+            if( reach[ i ].contains( name ) ) continue;
+            if( refs.contains( name ) ) {
+                reach[ i ].insert( name );
+                todo.insert( todo.end(), refs[ name ].begin(), refs[ name ].end() );
+            }
+            else if( s.buffers.contains( name ) ) reach[ i ].insert( name );
+        }
+    }
+    auto conflict = [ & ]( int a, int b ) {
+        if( queue_refs[ a ].second || queue_refs[ b ].second ) return true;
+        if( reach[ a ].contains( s.queue[ b ].name ) || reach[ b ].contains( s.queue[ a ].name ) ) return true;
+        for( auto& r : reach[ a ] ) if( refs.contains( r ) && reach[ b ].contains( r ) ) return true;
+        return false;
+    };
+    std::vector< int > stage( n, 0 );
+    s.stages.clear();
+    for( int i = 0; i < n; i++ ) {
+        for( int k = 0; k < i; k++ ) if( conflict( k, i ) ) stage[ i ] = std::max( stage[ i ], stage[ k ] + 1 );
+        if( (size_t)stage[ i ] >= s.stages.size() ) s.stages.resize( stage[ i ] + 1 );
+        s.stages[ stage[ i ] ].push_back( i );
+    }
 }
 
 void scene_reader::read_widget_group( const json& j ) {
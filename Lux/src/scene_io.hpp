@@ -13,6 +13,8 @@ struct scene_reader {
     std::map< std::string, std::string > CA_targets; // Handle forward references to cellular automata target buffers
     std::map< std::string, std::string > cluster_elements; // Element for each cluster. Elements copied to clusters after buffers added to elements.
     std::map< std::string, std::string > fill_warp_vfs; // Vector field for each fill_warp effect. Vector fields copied to fill_warps after buffers added to vector fields.
+    std::map< std::string, std::vector< std::string > > refs; // strings in the JSON of each effect, function, element and cluster - used to find what each queue entry touches
+    std::vector< std::pair< std::vector< std::string >, bool > > queue_refs; // source and effect names of each queue entry, and whether it must render alone
 
     scene_reader( scene& s_init, std::string( filename ) );
 
@@ -75,6 +77,9 @@ struct scene_reader {
     void read_cluster(  const json& j );
     void read_queue(    const json& j, effect_list& elist );
 
+    void record_refs( const std::string& name, const json& j );
+    void plan_stages(); // group queue into stages of lists that can render in parallel
+
     template< class T > void read_harness( const json& j, harness< T >& h );
     #define READ_ANY_HARNESS( _T_ ) void read_any_harness( const json& j, harness< _T_ >& h )  { read_harness< _T_ >( j, h ); }
     READ_ANY_HARNESS( float )
@@ -0,0 +1,66 @@
+#include "splat_batch.hpp"
+#include "thread_pool.hpp"
+
+template< class T > splat_batch< T >::splat_batch( image< T >& target_init, const int& tile_size_init, const int& threads_init ) 
+    : target( target_init ), tile_size( tile_size_init ), threads( threads_init ) {}
+
+template< class T > void splat_batch< T >::add( 
+    const image< T >& splat_image,
+    const bool& smooth,
+    const vec2f& center,
+    const float& scale,
+    const float& theta,
+    const std::optional< std::reference_wrapper< const image< T > > > mask,
+    const std::optional< T >& tint,
+    const mask_mode& mmode )
+{
+    // splatting the target onto itself depends on the order pixels are written, so draw it right away
+    if( &splat_image == &target || ( mask.has_value() && &( mask->get() ) == &target ) ) {
+        draw();
+        target.splat( splat_image, smooth, center, scale, theta, mask, tint, mmode );
+        return;
+    }
+    commands.push_back( target.splat_prepare( splat_image, smooth, center, scale, theta, mask, tint, mmode ) );
+}
+
+template< class T > void splat_batch< T >::draw() {
+    if( commands.empty() ) return;
+    if( tile_size < 1 ) throw std::runtime_error( "splat_batch: tile_size must be positive" );
+    vec2i dim = target.get_dim();
+    vec2i tiles( ( dim.x + tile_size - 1 ) / tile_size, ( dim.y + tile_size - 1 ) / tile_size );
+    bins.resize( tiles.x * tiles.y );
+    for( auto& b : bins ) b.clear();
+
+    // bin each splat into every tile its bounding box touches
+    for( int i = 0; i < commands.size(); i++ ) {
+        const bb2i& sb = commands[ i ].sbounds;
+        if( sb.maxv.x <= 0 || sb.maxv.y <= 0 ) continue;
+        int tx0 = std::max( sb.minv.x, 0 ) / tile_size, tx1 = ( std::min( sb.maxv.x, dim.x ) - 1 ) / tile_size;
+        int ty0 = std::max( sb.minv.y, 0 ) / tile_size, ty1 = ( std::min( sb.maxv.y, dim.y ) - 1 ) / tile_size;
+        for( int ty = ty0; ty <= ty1; ty++ )
+            for( int tx = tx0; tx <= tx1; tx++ ) bins[ ty * tiles.x + tx ].push_back( i );
+    }
+
+    auto draw_tiles = [ & ]( int t0, int t1, int chunk ) {
+        for( int t = t0; t < t1; t++ ) {
+            vec2i corner( t % tiles.x * tile_size, t / tiles.x * tile_size );
+            bb2i clip( corner, corner + tile_size );
+            for( int i : bins[ t ] ) target.splat_draw( commands[ i ], clip );
+        }
+    };
+    int ntiles = tiles.x * tiles.y;
+    int nthreads = std::min( threads > 0 ? threads : (int)global_pool().size(), ntiles );
+    // tiles vary a lot in cost, so hand out several runs of tiles per thread
+    if( nthreads > 1 ) global_pool().parallel_for( ntiles, nthreads * 4, draw_tiles );
+    else draw_tiles( 0, ntiles, 0 );
+    for( auto& c : commands ) target.mark_dirty( c.sbounds );
+    commands.clear();
+}
+
+template< class T > size_t splat_batch< T >::size() const { return commands.size(); }
+
+template class splat_batch< frgb   >;
+template class splat_batch< ucolor >;
+template class splat_batch< vec2f  >;
+template class splat_batch< int    >;
+template class splat_batch< vec2i  >;
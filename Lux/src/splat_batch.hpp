@@ -0,0 +1,37 @@
+#ifndef __SPLAT_BATCH_HPP
+#define __SPLAT_BATCH_HPP
+
+#include "image.hpp"
+
+// Deferred splatting. Splats are recorded with their transforms worked out, then drawn into the target
+// one tile at a time, so each tile is finished while it is still in cache. Within a tile, splats are drawn 
+// in the order they were added, so the result is the same as splatting each one immediately. Tiles never
+// share pixels, so they can also be drawn in parallel on the thread pool.
+
+template< class T > class splat_batch {
+    image< T >& target;
+    std::vector< splat_setup< T > > commands;
+    std::vector< std::vector< int > > bins;   // indices into commands for each tile, in submission order
+
+public:
+    int tile_size;
+    int threads;    // tiles drawn in parallel. 1 runs serially, 0 uses all available
+
+    splat_batch( image< T >& target_init, const int& tile_size_init = 256, const int& threads_init = 1 );
+
+    // same arguments as image::splat()
+    void add( 
+        const image< T >& splat_image,
+        const bool& smooth = false,
+        const vec2f& center = { 0.0f, 0.0f },
+        const float& scale = 1.0f,
+        const float& theta = 0.0f,
+        const std::optional< std::reference_wrapper< const image< T > > > mask = std::nullopt,
+        const std::optional< T >& tint = std::nullopt,
+        const mask_mode& mmode = MASK_BLEND
+    );
+    void draw();    // draw everything recorded so far and clear the list
+    size_t size() const;
+};
+
+#endif // __SPLAT_BATCH_HPP
@@ -0,0 +1,67 @@
+#include "uimage.hpp"
+#include "fimage.hpp"
+#include "splat_batch.hpp"
+#include "joy_rand.hpp"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+// Times image::splat() over a sweep of element counts and scales, the way a cluster draws into a frame.
+// Each row splats random positions and rotations of one splat image - with and without mask and tint,
+// and plain splats recorded into a splat_batch and drawn tile by tile on [threads] threads.
+// Usage: ./splat_bench [size] [splat_size] [repeats] [threads]
+
+template< class T > T random_pixel();
+template<> ucolor random_pixel() { return rand_uint( gen ); }
+template<> frgb   random_pixel() { return frgb( rand1( gen ), rand1( gen ), rand1( gen ) ); }
+
+template< class T > void bench( const std::string& name, int size, int splat_size, int repeats, int threads ) {
+    typedef std::chrono::steady_clock clock;
+    image< T > target( vec2i( size, size ) ), splat( vec2i( splat_size, splat_size ) ), mask( vec2i( splat_size, splat_size ) );
+    for( auto& p : splat ) p = random_pixel< T >();
+    for( auto& p : mask )  p = random_pixel< T >();
+    T tint = random_pixel< T >();
+
+    std::cout << name << " " << size << "x" << size << " target, " << splat_size << "x" << splat_size << " splat - ms per frame" << std::endl;
+    std::cout << std::right << std::setw( 10 ) << "elements" << std::setw( 8 ) << "scale"
+              << std::setw( 10 ) << "plain" << std::setw( 10 ) << "tint" << std::setw( 10 ) << "mask" << std::setw( 10 ) << "batched" << std::endl;
+    for( int count : { 10, 100, 1000 } ) {
+        for( float scale : { 0.01f, 0.05f, 0.2f } ) {
+            std::vector< vec2f > centers( count );
+            std::vector< float > thetas( count );
+            for( int i = 0; i < count; i++ ) { centers[ i ] = { rand1( gen ) * 2.0f - 1.0f, rand1( gen ) * 2.0f - 1.0f }; thetas[ i ] = rand1( gen ) * 360.0f; }
+            std::cout << std::setw( 10 ) << count << std::setw( 8 ) << std::setprecision( 2 ) << std::fixed << scale;
+            for( int variant = 0; variant < 3; variant++ ) {
+                std::optional< std::reference_wrapper< const image< T > > > m;
+                std::optional< T > t;
+                if( variant == 1 ) t = tint;
+                if( variant == 2 ) m = mask;
+                auto t0 = clock::now();
+                for( int r = 0; r < repeats; r++ )
+                    for( int i = 0; i < count; i++ ) target.splat( splat, false, centers[ i ], scale, thetas[ i ], m, t );
+                auto t1 = clock::now();
+                std::cout << std::setw( 10 ) << std::setprecision( 3 ) << std::chrono::duration< double, std::milli >( t1 - t0 ).count() / repeats;
+            }
+            splat_batch< T > batch( target, 256, threads );
+            auto t0 = clock::now();
+            for( int r = 0; r < repeats; r++ ) {
+                for( int i = 0; i < count; i++ ) batch.add( splat, false, centers[ i ], scale, thetas[ i ] );
+                batch.draw();
+            }
+            auto t1 = clock::now();
+            std::cout << std::setw( 10 ) << std::setprecision( 3 ) << std::chrono::duration< double, std::milli >( t1 - t0 ).count() / repeats;
+            std::cout << std::endl;
+        }
+    }
+}
+
+int main( int argc, char** argv ) {
+    int size = 1024, splat_size = 256, repeats = 3, threads = 1;
+    if( argc > 1 ) std::stringstream( argv[ 1 ] ) >> size;
+    if( argc > 2 ) std::stringstream( argv[ 2 ] ) >> splat_size;
+    if( argc > 3 ) std::stringstream( argv[ 3 ] ) >> repeats;
+    if( argc > 4 ) std::stringstream( argv[ 4 ] ) >> threads;
+    bench< ucolor >( "ucolor", size, splat_size, repeats, threads );
+    bench< frgb >( "frgb", size, splat_size, repeats, threads );
+    return 0;
+}
@@ -4,8 +4,15 @@
 
 // simple conversion and manipulation of image binary files
 
-void to_frgb_file( std::string& in_filename, std::string& out_filename ) {
+void to_frgb_file( std::string& in_filename, std::string& out_filename, bool with_mip = false ) {
     fimage img( in_filename );
+    img.write_binary( out_filename, with_mip );
+}
+
+// rewrites a binary file in the current format - also reads files without a header
+void upgrade_file( std::string& in_filename, std::string& out_filename ) {
+    fimage img;
+    img.read_binary( in_filename );
     img.write_binary( out_filename );
 }
 
@@ -28,14 +35,25 @@ void subtract_image( std::string& file1, std::string& file2, std::string& basena
 }
 
 int main( int argc, char** argv ) {
-    if( argc < 3 ) {
-        std::cout << "Usage: ./sploot file_in file_out\n./sploot -fromBinary file_in file_out\n./sploot -subtract file1 file2 basename\n";
+    // options take one more argument than a plain conversion, -subtract two more
+    int needed = 3;
+    if( argc > 1 && argv[ 1 ][ 0 ] == '-' ) needed = std::string( argv[ 1 ] ) == "-subtract" ? 5 : 4;
+    if( argc < needed ) {
+        std::cout << "Usage: ./sploot file_in file_out\n./sploot -mip file_in file_out\n./sploot -fromBinary file_in file_out\n./sploot -upgrade file_in file_out\n./sploot -subtract file1 file2 basename\n";
         return 0;
     }
     if( std::string( argv[ 1 ]) == "-fromBinary" ) {
         std::string in_name(  argv[ 2 ] );
         std::string out_name( argv[ 3 ] );
         to_jpg_file( in_name, out_name );
+    } else if( std::string( argv[ 1 ]) == "-mip" ) {
+        std::string in_name(  argv[ 2 ] );
+        std::string out_name( argv[ 3 ] );
+        to_frgb_file( in_name, out_name, true );
+    } else if( std::string( argv[ 1 ]) == "-upgrade" ) {
+        std::string in_name(  argv[ 2 ] );
+        std::string out_name( argv[ 3 ] );
+        upgrade_file( in_name, out_name );
     } else if( std::string( argv[ 1 ]) == "-subtract" ) {
         std::string file1(  argv[ 2 ] );
         std::string file2( argv[ 3 ] );
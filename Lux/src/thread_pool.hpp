@@ -0,0 +1,135 @@
+// Persistent pool of worker threads for splitting per-pixel loops into stripes
+// The calling thread helps drain the queue while it waits, so nested calls cannot deadlock
+// Web builds have no pthreads, so everything runs on the calling thread there
+
+#ifndef __THREAD_POOL_HPP
+#define __THREAD_POOL_HPP
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+class thread_pool {
+#ifndef __EMSCRIPTEN__
+    std::vector< std::thread > workers;
+    std::deque< std::function< void () > > tasks;
+    std::mutex m;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void work() {
+        for( ;; ) {
+            std::function< void () > task;
+            {
+                std::unique_lock< std::mutex > lock( m );
+                cv.wait( lock, [ this ] { return stopping || !tasks.empty(); } );
+                if( tasks.empty() ) return;
+                task = std::move( tasks.front() );
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    // runs one queued task on the calling thread, returns false if queue was empty
+    bool run_one() {
+        std::function< void () > task;
+        {
+            std::lock_guard< std::mutex > lock( m );
+            if( tasks.empty() ) return false;
+            task = std::move( tasks.front() );
+            tasks.pop_front();
+        }
+        task();
+        return true;
+    }
+#endif // __EMSCRIPTEN__
+
+public:
+    // number of threads available to a parallel_for, including the calling thread
+    unsigned int size() const {
+#ifndef __EMSCRIPTEN__
+        return workers.size() + 1;
+#else
+        return 1;
+#endif
+    }
+
+    // Splits [ 0, n ) into nchunks contiguous ranges and calls fn( begin, end, chunk ) for each.
+    // Returns when all chunks are finished. First exception thrown by any chunk is rethrown here.
+    void parallel_for( int n, int nchunks, const std::function< void ( int, int, int ) >& fn ) {
+        nchunks = std::clamp( nchunks, 1, std::max( n, 1 ) );
+        auto chunk_begin = [ n, nchunks ]( int c ) { return (int)( (long long)n * c / nchunks ); };
+#ifndef __EMSCRIPTEN__
+        if( nchunks > 1 && workers.size() ) {
+            std::mutex done_m;
+            std::condition_variable done_cv;
+            int remaining = nchunks - 1;
+            std::exception_ptr error;
+
+            auto finish = [ & ]( std::exception_ptr e ) {
+                std::lock_guard< std::mutex > lock( done_m );
+                if( e && !error ) error = e;
+                if( --remaining == 0 ) done_cv.notify_one();
+            };
+            {
+                std::lock_guard< std::mutex > lock( m );
+                for( int c = 1; c < nchunks; c++ ) {
+                    tasks.push_back( [ &, c ] {
+                        std::exception_ptr e;
+                        try { fn( chunk_begin( c ), chunk_begin( c + 1 ), c ); }
+                        catch( ... ) { e = std::current_exception(); }
+                        finish( e );
+                    } );
+                }
+            }
+            cv.notify_all();
+
+            std::exception_ptr e;
+            try { fn( chunk_begin( 0 ), chunk_begin( 1 ), 0 ); }
+            catch( ... ) { e = std::current_exception(); }
+
+            // help out until queue is empty, then wait for stragglers
+            while( run_one() ) {}
+            std::unique_lock< std::mutex > lock( done_m );
+            done_cv.wait( lock, [ & ] { return remaining == 0; } );
+            if( e ) std::rethrow_exception( e );
+            if( error ) std::rethrow_exception( error );
+            return;
+        }
+#endif // __EMSCRIPTEN__
+        for( int c = 0; c < nchunks; c++ ) fn( chunk_begin( c ), chunk_begin( c + 1 ), c );
+    }
+
+#ifndef __EMSCRIPTEN__
+    thread_pool( unsigned int nthreads = std::thread::hardware_concurrency() ) {
+        for( unsigned int i = 1; i < nthreads; i++ ) workers.emplace_back( [ this ] { work(); } );
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard< std::mutex > lock( m );
+            stopping = true;
+        }
+        cv.notify_all();
+        for( auto& w : workers ) w.join();
+    }
+#else
+    thread_pool( unsigned int nthreads = 1 ) {}
+#endif // __EMSCRIPTEN__
+};
+
+// Process-wide pool sized to the hardware, created on first use
+inline thread_pool& global_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+#endif // __THREAD_POOL_HPP
@@ -5,12 +5,10 @@
 #include "gamma_lut.hpp"
 #include "joy_rand.hpp"
 
-static gamma_LUT glut( 2.2f );
-
 float af( const ucolor &c )       { return ac( c ) / 255.0f; }
-float rf( const ucolor &c )       { return glut.SRGB_to_linear( rc( c ) ); }
-float gf( const ucolor &c )       { return glut.SRGB_to_linear( gc( c ) ); }
-float bf( const ucolor &c )       { return glut.SRGB_to_linear( bc( c ) ); }
+float rf( const ucolor &c )       { return srgb_gamma().SRGB_to_linear( rc( c ) ); }
+float gf( const ucolor &c )       { return srgb_gamma().SRGB_to_linear( gc( c ) ); }
+float bf( const ucolor &c )       { return srgb_gamma().SRGB_to_linear( bc( c ) ); }
 
 // returns single bytes per component 
 unsigned char ac( const ucolor &c ) {  return (unsigned char) ( ( c >> 24 ) & 0xff ); }
@@ -20,11 +18,11 @@ unsigned char bc( const ucolor &c ) {  return (unsigned char) ( ( c       ) & 0x
 
 // set component
 void setaf( ucolor &c, const float& a )   { setac( c, ( unsigned char )( std::clamp( a, 0.0f, 1.0f ) * 255.0f ) ); }
-void setrf( ucolor &c, const float& r )   { setrc( c, glut.linear_to_SRGB( r ) ); }
-void setgf( ucolor &c, const float& g )   { setgc( c, glut.linear_to_SRGB( g ) ); }
-void setbf( ucolor &c, const float& b )   { setbc( c, glut.linear_to_SRGB( b ) ); }
-void setf(  ucolor &c, const float& r, const float& g, const float& b) { setc( c, glut.linear_to_SRGB( r ), glut.linear_to_SRGB( g ), glut.linear_to_SRGB( b )); }
-ucolor usetf( const float& r, const float& g, const float& b ) { return usetc(    glut.linear_to_SRGB( r ), glut.linear_to_SRGB( g ), glut.linear_to_SRGB( b )); }
+void setrf( ucolor &c, const float& r )   { setrc( c, srgb_gamma().linear_to_SRGB( r ) ); }
+void setgf( ucolor &c, const float& g )   { setgc( c, srgb_gamma().linear_to_SRGB( g ) ); }
+void setbf( ucolor &c, const float& b )   { setbc( c, srgb_gamma().linear_to_SRGB( b ) ); }
+void setf(  ucolor &c, const float& r, const float& g, const float& b) { setc( c, srgb_gamma().linear_to_SRGB( r ), srgb_gamma().linear_to_SRGB( g ), srgb_gamma().linear_to_SRGB( b )); }
+ucolor usetf( const float& r, const float& g, const float& b ) { return usetc(    srgb_gamma().linear_to_SRGB( r ), srgb_gamma().linear_to_SRGB( g ), srgb_gamma().linear_to_SRGB( b )); }
 
 void setac( ucolor &c, const unsigned char& a ) { c = ( c & 0x00ffffff ) | ( ( (unsigned int)a ) << 24 ); }
 void setrc( ucolor &c, const unsigned char& b ) { c = ( c & 0xffffff00 ) | (   (unsigned int)b         ); }
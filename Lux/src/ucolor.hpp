@@ -6,6 +6,7 @@
 
 #include "mask_mode.hpp"
 #include <algorithm>
+#include <vector>
 typedef unsigned int ucolor;
 
 float af( const ucolor &c );
@@ -121,27 +122,28 @@ static inline void subc( ucolor& c1, const ucolor& c2 )
    c1 = ( c1 & 0xff000000 ) + r + g + b;
 }
 
-// multiply colors, handling overflow
+// multiply colors channel by channel ( 255 * 255 -> 254 ), alpha from c1
 static inline ucolor mulc( const ucolor& c1, const ucolor& c2 )
 {
    return ( c1 & 0xff000000 ) + 
-      std::min< unsigned int>( ( ( c1 & 0x00ff0000 ) * ( c2 & 0x00ff0000 ) ) >> 8, 0x00ff0000 ) +
-      std::min< unsigned int>( ( ( c1 & 0x0000ff00 ) * ( c2 & 0x0000ff00 ) ) >> 8, 0x0000ff00 ) +
-      std::min< unsigned int>( ( ( c1 & 0x000000ff ) * ( c2 & 0x000000ff ) ) >> 8, 0x000000ff );
+      ( ( ( ( ( c1 & 0x00ff0000 ) >> 16 ) * ( ( c2 & 0x00ff0000 ) >> 16 ) ) >> 8 ) << 16 ) +
+      ( ( ( ( ( c1 & 0x0000ff00 ) >>  8 ) * ( ( c2 & 0x0000ff00 ) >>  8 ) ) >> 8 ) <<  8 ) +
+        ( ( (   ( c1 & 0x000000ff )         * ( c2 & 0x000000ff ) )         >> 8 ) );
 }
 
-static inline void rotate_color( ucolor& c, const int& r )
+// rotate color channels - 1 moves red to green, green to blue and blue to red, 2 goes the other way
+static inline ucolor rotate_color( const ucolor& c, const int& r )
 {
-   if(      !r%1 ) c = ( c & 0xff000000 ) | ( c & 0x00ffff00 >> 8 ) | ( c & 0x000000ff << 16 );
-   else if( !r%2 ) c = ( c & 0xff000000 ) | ( c & 0x0000ffff << 8 ) | ( c & 0x00ff0000 >> 16 );
- 
+   switch( ( r % 3 + 3 ) % 3 ) {
+      case 1:  return ( c & 0xff000000 ) | ( ( c & 0x00ffff00 ) >> 8 ) | ( ( c & 0x000000ff ) << 16 );
+      case 2:  return ( c & 0xff000000 ) | ( ( c & 0x0000ffff ) << 8 ) | ( ( c & 0x00ff0000 ) >> 16 );
+      default: return c;
+   }
 }
 
-static inline ucolor rotate_color( const ucolor& c, const int& r )
+static inline void rotate_color( ucolor& c, const int& r )
 {
-   if(      !r%1 ) return ( c & 0xff000000 ) | ( c & 0x00ffff00 >> 8 ) | ( c & 0x000000ff << 16 );
-   else if( !r%2 ) return ( c & 0xff000000 ) | ( c & 0x0000ffff << 8 ) | ( c & 0x00ff0000 >> 16 );
-   else return c;
+   c = rotate_color( (const ucolor&)c, r );
 }
 
 static inline void invert( ucolor& c )
@@ -0,0 +1,249 @@
+// Batch versions of ucolor channel arithmetic
+// SSE2 and NEON kernels live here, AVX2 in ucolor_batch_avx2.cpp. Leftover pixels at the end of a run
+// go through the single pixel functions, so every instruction set gives the same result.
+
+#include "ucolor_batch.hpp"
+#include "ucolor_kernels.hpp"
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && defined( __GNUC__ ) && !defined( __EMSCRIPTEN__ )
+#define UCOLOR_X86
+#include <immintrin.h>
+#elif defined( __ARM_NEON ) && !defined( __EMSCRIPTEN__ )
+#define UCOLOR_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef UCOLOR_X86
+struct isa_sse2 {
+    typedef __m128i reg;
+    typedef __m128i reg16;
+    static constexpr size_t width = 4;
+
+    static inline reg  load(  const ucolor* p )  { return _mm_loadu_si128( (const __m128i*)p ); }
+    static inline void store( ucolor* p, reg a ) { _mm_storeu_si128( (__m128i*)p, a ); }
+    static inline reg  set1(  ucolor c )         { return _mm_set1_epi32( (int)c ); }
+    static inline reg  and_(  reg a, reg b )     { return _mm_and_si128( a, b ); }
+    static inline reg  or_(   reg a, reg b )     { return _mm_or_si128(  a, b ); }
+    static inline reg  xor_(  reg a, reg b )     { return _mm_xor_si128( a, b ); }
+    static inline reg  adds8( reg a, reg b )     { return _mm_adds_epu8( a, b ); }
+    static inline reg  subs8( reg a, reg b )     { return _mm_subs_epu8( a, b ); }
+    static inline reg  add32( reg a, reg b )     { return _mm_add_epi32( a, b ); }
+    template< int n > static inline reg srli32( reg a ) { return _mm_srli_epi32( a, n ); }
+    template< int n > static inline reg slli32( reg a ) { return _mm_slli_epi32( a, n ); }
+
+    static inline reg16 lo16(  reg a )            { return _mm_unpacklo_epi8( a, _mm_setzero_si128() ); }
+    static inline reg16 hi16(  reg a )            { return _mm_unpackhi_epi8( a, _mm_setzero_si128() ); }
+    static inline reg16 spread_lo16( reg a )      { return _mm_unpacklo_epi32( a, a ); } // each 32 bit lane repeated, lo16 pixel order
+    static inline reg16 spread_hi16( reg a )      { return _mm_unpackhi_epi32( a, a ); }
+    static inline reg   pack16( reg16 lo, reg16 hi ) { return _mm_packus_epi16( lo, hi ); }
+    static inline reg16 set16( unsigned short s ) { return _mm_set1_epi16( (short)s ); }
+    static inline reg16 add16( reg16 a, reg16 b ) { return _mm_add_epi16(   a, b ); }
+    static inline reg16 sub16( reg16 a, reg16 b ) { return _mm_sub_epi16(   a, b ); }
+    static inline reg16 mul16( reg16 a, reg16 b ) { return _mm_mullo_epi16( a, b ); }
+    template< int n > static inline reg16 srli16( reg16 a ) { return _mm_srli_epi16( a, n ); }
+};
+
+#endif // UCOLOR_X86
+
+#ifdef UCOLOR_NEON
+struct isa_neon {
+    typedef uint8x16_t reg;
+    typedef uint16x8_t reg16;
+    static constexpr size_t width = 4;
+
+    static inline uint32x4_t u32( reg a )        { return vreinterpretq_u32_u8( a ); }
+    static inline reg  u8( uint32x4_t a )        { return vreinterpretq_u8_u32( a ); }
+
+    static inline reg  load(  const ucolor* p )  { return vld1q_u8( (const uint8_t*)p ); }
+    static inline void store( ucolor* p, reg a ) { vst1q_u8( (uint8_t*)p, a ); }
+    static inline reg  set1(  ucolor c )         { return u8( vdupq_n_u32( c ) ); }
+    static inline reg  and_(  reg a, reg b )     { return vandq_u8( a, b ); }
+    static inline reg  or_(   reg a, reg b )     { return vorrq_u8( a, b ); }
+    static inline reg  xor_(  reg a, reg b )     { return veorq_u8( a, b ); }
+    static inline reg  adds8( reg a, reg b )     { return vqaddq_u8( a, b ); }
+    static inline reg  subs8( reg a, reg b )     { return vqsubq_u8( a, b ); }
+    static inline reg  add32( reg a, reg b )     { return u8( vaddq_u32( u32( a ), u32( b ) ) ); }
+    template< int n > static inline reg srli32( reg a ) { return u8( vshrq_n_u32( u32( a ), n ) ); }
+    template< int n > static inline reg slli32( reg a ) { return u8( vshlq_n_u32( u32( a ), n ) ); }
+
+    static inline reg16 lo16(  reg a )            { return vmovl_u8( vget_low_u8(  a ) ); }
+    static inline reg16 hi16(  reg a )            { return vmovl_u8( vget_high_u8( a ) ); }
+    static inline reg16 spread_lo16( reg a )      { return vreinterpretq_u16_u32( vzipq_u32( u32( a ), u32( a ) ).val[ 0 ] ); }
+    static inline reg16 spread_hi16( reg a )      { return vreinterpretq_u16_u32( vzipq_u32( u32( a ), u32( a ) ).val[ 1 ] ); }
+    static inline reg   pack16( reg16 lo, reg16 hi ) { return vcombine_u8( vqmovn_u16( lo ), vqmovn_u16( hi ) ); }
+    static inline reg16 set16( unsigned short s ) { return vdupq_n_u16( s ); }
+    static inline reg16 add16( reg16 a, reg16 b ) { return vaddq_u16( a, b ); }
+    static inline reg16 sub16( reg16 a, reg16 b ) { return vsubq_u16( a, b ); }
+    static inline reg16 mul16( reg16 a, reg16 b ) { return vmulq_u16( a, b ); }
+    template< int n > static inline reg16 srli16( reg16 a ) { return vshrq_n_u16( a, n ); }
+};
+
+// structured loads and stores split and merge the channels directly, sixteen pixels at a time
+static size_t pack_rgb_neon( ucolor* out, const unsigned char* rgb, size_t n ) {
+    size_t i = 0;
+    for( ; i + 16 <= n; i += 16 ) {
+        uint8x16x3_t in = vld3q_u8( rgb + i * 3 );
+        uint8x16x4_t px = { { in.val[ 0 ], in.val[ 1 ], in.val[ 2 ], vdupq_n_u8( 0xff ) } };
+        vst4q_u8( (uint8_t*)( out + i ), px );
+    }
+    return i;
+}
+
+static size_t unpack_rgb_neon( unsigned char* rgb, const ucolor* in, size_t n ) {
+    size_t i = 0;
+    for( ; i + 16 <= n; i += 16 ) {
+        uint8x16x4_t px = vld4q_u8( (const uint8_t*)( in + i ) );
+        uint8x16x3_t out = { { px.val[ 2 ], px.val[ 1 ], px.val[ 0 ] } };
+        vst3q_u8( rgb + i * 3, out );
+    }
+    return i;
+}
+#endif // UCOLOR_NEON
+
+// no kernels - everything is left to the single pixel loops
+struct scalar_kernels {
+    static size_t blend( ucolor*, const ucolor*, const ucolor*, unsigned int, size_t ) { return 0; }
+    static size_t blend_each( ucolor*, const ucolor*, const ucolor*, const unsigned int*, size_t ) { return 0; }
+    template< bool single > static size_t addc( ucolor*, const ucolor*, size_t ) { return 0; }
+    template< bool single > static size_t subc( ucolor*, const ucolor*, size_t ) { return 0; }
+    template< bool single > static size_t mulc( ucolor*, const ucolor*, size_t ) { return 0; }
+    static size_t manhattan( unsigned int*, const ucolor*, const ucolor*, size_t ) { return 0; }
+    static size_t apply_mask( ucolor*, const ucolor*, const ucolor*, size_t ) { return 0; }
+    static size_t rotate_color( ucolor*, int, size_t ) { return 0; }
+    static size_t invert( ucolor*, size_t ) { return 0; }
+    static size_t sample_nearest( ucolor*, const ucolor*, int, int, int, int, int, size_t ) { return 0; }
+    static size_t pack_rgb( ucolor*, const unsigned char*, size_t ) { return 0; }
+    static size_t unpack_rgb( unsigned char*, const ucolor*, size_t ) { return 0; }
+};
+
+static bool isa_supported( ucolor_isa isa ) {
+    switch( isa ) {
+        case ISA_SCALAR: return true;
+#ifdef UCOLOR_X86
+        case ISA_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports( "sse2" );
+        case ISA_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports( "avx2" ) && avx2_batch_table();
+#endif
+#ifdef UCOLOR_NEON
+        case ISA_NEON: return true;
+#endif
+        default: return false;
+    }
+}
+
+static batch_table table_for( ucolor_isa isa ) {
+    switch( isa ) {
+#ifdef UCOLOR_X86
+        case ISA_SSE2: return make_batch_table< ucolor_kernels< isa_sse2 > >();
+        case ISA_AVX2: return *avx2_batch_table();
+#endif
+#ifdef UCOLOR_NEON
+        case ISA_NEON: {
+            batch_table t = make_batch_table< ucolor_kernels< isa_neon > >();
+            t.pack_rgb = pack_rgb_neon;
+            t.unpack_rgb = unpack_rgb_neon;
+            return t;
+        }
+#endif
+        default: return make_batch_table< scalar_kernels >();
+    }
+}
+
+ucolor_isa best_isa() {
+    for( ucolor_isa isa : { ISA_AVX2, ISA_NEON, ISA_SSE2 } ) if( isa_supported( isa ) ) return isa;
+    return ISA_SCALAR;
+}
+
+// chosen on first use, so batch functions are safe to call from static initializers
+static ucolor_isa& current_isa() {
+    static ucolor_isa isa = best_isa();
+    return isa;
+}
+
+static batch_table& active() {
+    static batch_table table = table_for( current_isa() );
+    return table;
+}
+
+ucolor_isa get_isa() { return current_isa(); }
+
+void set_isa( ucolor_isa isa ) {
+    current_isa() = isa_supported( isa ) ? isa : ISA_SCALAR;
+    active() = table_for( current_isa() );
+}
+
+const char* isa_name( ucolor_isa isa ) {
+    switch( isa ) {
+        case ISA_SSE2: return "sse2";
+        case ISA_AVX2: return "avx2";
+        case ISA_NEON: return "neon";
+        default:       return "scalar";
+    }
+}
+
+void blend_n( ucolor* out, const ucolor* a, const ucolor* b, unsigned int prop, size_t n ) {
+    prop = std::min( prop, 256u );
+    for( size_t i = active().blend( out, a, b, prop, n ); i < n; i++ ) out[ i ] = blend( a[ i ], b[ i ], prop );
+}
+
+void blend_n( ucolor* out, const ucolor* a, const ucolor* b, const unsigned int* prop, size_t n ) {
+    for( size_t i = active().blend_each( out, a, b, prop, n ); i < n; i++ ) out[ i ] = blend( a[ i ], b[ i ], prop[ i ] );
+}
+
+void addc_n( ucolor* c1, const ucolor* c2, size_t n ) {
+    for( size_t i = active().addc( c1, c2, n ); i < n; i++ ) addc( c1[ i ], c2[ i ] );
+}
+
+void addc_n( ucolor* c1, const ucolor& c2, size_t n ) {
+    for( size_t i = active().addc_single( c1, &c2, n ); i < n; i++ ) addc( c1[ i ], c2 );
+}
+
+void subc_n( ucolor* c1, const ucolor* c2, size_t n ) {
+    for( size_t i = active().subc( c1, c2, n ); i < n; i++ ) subc( c1[ i ], c2[ i ] );
+}
+
+void subc_n( ucolor* c1, const ucolor& c2, size_t n ) {
+    for( size_t i = active().subc_single( c1, &c2, n ); i < n; i++ ) subc( c1[ i ], c2 );
+}
+
+void mulc_n( ucolor* c1, const ucolor* c2, size_t n ) {
+    for( size_t i = active().mulc( c1, c2, n ); i < n; i++ ) c1[ i ] = mulc( c1[ i ], c2[ i ] );
+}
+
+void mulc_n( ucolor* c1, const ucolor& c2, size_t n ) {
+    for( size_t i = active().mulc_single( c1, &c2, n ); i < n; i++ ) c1[ i ] = mulc( c1[ i ], c2 );
+}
+
+void manhattan_n( unsigned int* out, const ucolor* a, const ucolor* b, size_t n ) {
+    for( size_t i = active().manhattan( out, a, b, n ); i < n; i++ ) out[ i ] = manhattan( a[ i ], b[ i ] );
+}
+
+// only MASK_BLEND so far, as in apply_mask()
+void apply_mask_n( ucolor* result, const ucolor* layer, const ucolor* mask, size_t n, const mask_mode& mmode ) {
+    for( size_t i = active().apply_mask( result, layer, mask, n ); i < n; i++ ) apply_mask( result[ i ], layer[ i ], mask[ i ], mmode );
+}
+
+void rotate_color_n( ucolor* c, const int& r, size_t n ) {
+    for( size_t i = active().rotate_color( c, r, n ); i < n; i++ ) rotate_color( c[ i ], r );
+}
+
+void invert_n( ucolor* c, size_t n ) {
+    for( size_t i = active().invert( c, n ); i < n; i++ ) invert( c[ i ] );
+}
+
+void sample_nearest_n( ucolor* out, const ucolor* src, int stride, int x, int y, int dx, int dy, size_t n ) {
+    for( size_t i = active().sample_nearest( out, src, stride, x, y, dx, dy, n ); i < n; i++ )
+        out[ i ] = src[ ( ( y + (int)i * dy ) >> 16 ) * stride + ( ( x + (int)i * dx ) >> 16 ) ];
+}
+
+void pack_rgb_n( ucolor* out, const unsigned char* rgb, size_t n ) {
+    for( size_t i = active().pack_rgb( out, rgb, n ); i < n; i++ )
+        out[ i ] = 0xff000000 | ( (ucolor)rgb[ i * 3 + 2 ] << 16 ) | ( (ucolor)rgb[ i * 3 + 1 ] << 8 ) | rgb[ i * 3 ];
+}
+
+void unpack_rgb_n( unsigned char* rgb, const ucolor* in, size_t n ) {
+    for( size_t i = active().unpack_rgb( rgb, in, n ); i < n; i++ ) {
+        rgb[ i * 3     ] = rc( in[ i ] );
+        rgb[ i * 3 + 1 ] = gc( in[ i ] );
+        rgb[ i * 3 + 2 ] = bc( in[ i ] );
+    }
+}
@@ -0,0 +1,38 @@
+// Batch versions of ucolor channel arithmetic over runs of pixels
+// Kernels use SSE2, AVX2 or NEON as available, chosen at runtime. Results match the single pixel functions in ucolor.hpp
+
+#ifndef __UCOLOR_BATCH_HPP
+#define __UCOLOR_BATCH_HPP
+
+#include "ucolor.hpp"
+#include <cstddef>
+
+enum ucolor_isa { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_NEON };
+
+ucolor_isa best_isa();              // best instruction set supported by this machine
+ucolor_isa get_isa();               // instruction set currently used by batch functions
+void set_isa( ucolor_isa isa );     // force instruction set (for testing) - falls back to scalar if unsupported
+const char* isa_name( ucolor_isa isa );
+
+// proportion 0-256 -> 0-100% of a
+void blend_n(        ucolor* out, const ucolor* a, const ucolor* b, unsigned int prop, size_t n );
+void blend_n(        ucolor* out, const ucolor* a, const ucolor* b, const unsigned int* prop, size_t n ); // one proportion per pixel, each 0-256
+void addc_n(         ucolor* c1,  const ucolor* c2, size_t n );
+void addc_n(         ucolor* c1,  const ucolor& c2, size_t n );
+void subc_n(         ucolor* c1,  const ucolor* c2, size_t n );
+void subc_n(         ucolor* c1,  const ucolor& c2, size_t n );
+void mulc_n(         ucolor* c1,  const ucolor* c2, size_t n );
+void mulc_n(         ucolor* c1,  const ucolor& c2, size_t n );
+void manhattan_n(    unsigned int* out, const ucolor* a, const ucolor* b, size_t n );
+void apply_mask_n(   ucolor* result, const ucolor* layer, const ucolor* mask, size_t n, const mask_mode& mmode = MASK_BLEND );
+void rotate_color_n( ucolor* c, const int& r, size_t n );
+void invert_n(       ucolor* c, size_t n );
+// nearest neighbor samples of src along a line - 16.16 fixed point coordinates start at ( x, y ) and step by ( dx, dy )
+// every coordinate must land inside the source image
+void sample_nearest_n( ucolor* out, const ucolor* src, int stride, int x, int y, int dx, int dy, size_t n );
+// three bytes per pixel, for image decoding and encoding - packing sets each channel as setrc / setgc / setbc would,
+// with alpha opaque, and unpacking writes rc / gc / bc
+void pack_rgb_n(     ucolor* out, const unsigned char* rgb, size_t n );
+void unpack_rgb_n(   unsigned char* rgb, const ucolor* in, size_t n );
+
+#endif // __UCOLOR_BATCH_HPP
@@ -0,0 +1,99 @@
+// AVX2 versions of the ucolor batch kernels
+// Built with -mavx2 on x86 (see CMakeLists.txt) and only called after a runtime check, so nothing else lives here
+
+#include "ucolor_kernels.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// unpack and pack work within 128 bit lanes, so lo16 / hi16 / pack16 still round trip
+struct isa_avx2 {
+    typedef __m256i reg;
+    typedef __m256i reg16;
+    static constexpr size_t width = 8;
+
+    static inline reg  load(  const ucolor* p )  { return _mm256_loadu_si256( (const __m256i*)p ); }
+    static inline void store( ucolor* p, reg a ) { _mm256_storeu_si256( (__m256i*)p, a ); }
+    static inline reg  set1(  ucolor c )         { return _mm256_set1_epi32( (int)c ); }
+    static inline reg  and_(  reg a, reg b )     { return _mm256_and_si256( a, b ); }
+    static inline reg  or_(   reg a, reg b )     { return _mm256_or_si256(  a, b ); }
+    static inline reg  xor_(  reg a, reg b )     { return _mm256_xor_si256( a, b ); }
+    static inline reg  adds8( reg a, reg b )     { return _mm256_adds_epu8( a, b ); }
+    static inline reg  subs8( reg a, reg b )     { return _mm256_subs_epu8( a, b ); }
+    static inline reg  add32( reg a, reg b )     { return _mm256_add_epi32( a, b ); }
+    template< int n > static inline reg srli32( reg a ) { return _mm256_srli_epi32( a, n ); }
+    template< int n > static inline reg slli32( reg a ) { return _mm256_slli_epi32( a, n ); }
+
+    static inline reg16 lo16(  reg a )            { return _mm256_unpacklo_epi8( a, _mm256_setzero_si256() ); }
+    static inline reg16 hi16(  reg a )            { return _mm256_unpackhi_epi8( a, _mm256_setzero_si256() ); }
+    static inline reg16 spread_lo16( reg a )      { return _mm256_unpacklo_epi32( a, a ); }
+    static inline reg16 spread_hi16( reg a )      { return _mm256_unpackhi_epi32( a, a ); }
+    static inline reg   pack16( reg16 lo, reg16 hi ) { return _mm256_packus_epi16( lo, hi ); }
+    static inline reg16 set16( unsigned short s ) { return _mm256_set1_epi16( (short)s ); }
+    static inline reg16 add16( reg16 a, reg16 b ) { return _mm256_add_epi16(   a, b ); }
+    static inline reg16 sub16( reg16 a, reg16 b ) { return _mm256_sub_epi16(   a, b ); }
+    static inline reg16 mul16( reg16 a, reg16 b ) { return _mm256_mullo_epi16( a, b ); }
+    template< int n > static inline reg16 srli16( reg16 a ) { return _mm256_srli_epi16( a, n ); }
+};
+
+// eight coordinates at a time - row * stride + column, then one gather
+static size_t sample_nearest_avx2( ucolor* out, const ucolor* src, int stride, int x, int y, int dx, int dy, size_t n ) {
+    __m256i k  = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+    __m256i vx = _mm256_add_epi32( _mm256_set1_epi32( x ), _mm256_mullo_epi32( k, _mm256_set1_epi32( dx ) ) );
+    __m256i vy = _mm256_add_epi32( _mm256_set1_epi32( y ), _mm256_mullo_epi32( k, _mm256_set1_epi32( dy ) ) );
+    __m256i sx = _mm256_slli_epi32( _mm256_set1_epi32( dx ), 3 );
+    __m256i sy = _mm256_slli_epi32( _mm256_set1_epi32( dy ), 3 );
+    __m256i vs = _mm256_set1_epi32( stride );
+    size_t i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        __m256i index = _mm256_add_epi32( _mm256_mullo_epi32( _mm256_srai_epi32( vy, 16 ), vs ), _mm256_srai_epi32( vx, 16 ) );
+        _mm256_storeu_si256( (__m256i*)( out + i ), _mm256_i32gather_epi32( (const int*)src, index, 4 ) );
+        vx = _mm256_add_epi32( vx, sx );
+        vy = _mm256_add_epi32( vy, sy );
+    }
+    return i;
+}
+
+// Eight pixels are 24 bytes. A cross-lane permute puts 12 bytes in each lane, then an in-lane shuffle spreads or gathers
+// them. Each full register load or store reaches 8 bytes past the pixels, so runs stop while that stays inside n
+static size_t pack_rgb_avx2( ucolor* out, const unsigned char* rgb, size_t n ) {
+    const __m256i spread = _mm256_setr_epi32( 0, 1, 2, 0, 3, 4, 5, 0 );
+    const __m256i shuffle = _mm256_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                              0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+    const __m256i alpha = _mm256_set1_epi32( (int)0xff000000 );
+    size_t i = 0;
+    for( ; i + 11 <= n; i += 8 ) {
+        __m256i in = _mm256_permutevar8x32_epi32( _mm256_loadu_si256( (const __m256i*)( rgb + i * 3 ) ), spread );
+        _mm256_storeu_si256( (__m256i*)( out + i ), _mm256_or_si256( _mm256_shuffle_epi8( in, shuffle ), alpha ) );
+    }
+    return i;
+}
+
+static size_t unpack_rgb_avx2( unsigned char* rgb, const ucolor* in, size_t n ) {
+    const __m256i shuffle = _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+    const __m256i gather = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 );
+    size_t i = 0;
+    for( ; i + 11 <= n; i += 8 ) {
+        __m256i px = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)( in + i ) ), shuffle );
+        _mm256_storeu_si256( (__m256i*)( rgb + i * 3 ), _mm256_permutevar8x32_epi32( px, gather ) );
+    }
+    return i;
+}
+
+const batch_table* avx2_batch_table() {
+    static batch_table table = [] {
+        batch_table t = make_batch_table< ucolor_kernels< isa_avx2 > >();
+        t.sample_nearest = sample_nearest_avx2;
+        t.pack_rgb = pack_rgb_avx2;
+        t.unpack_rgb = unpack_rgb_avx2;
+        return t;
+    }();
+    return &table;
+}
+
+#else
+
+const batch_table* avx2_batch_table() { return nullptr; }
+
+#endif // __AVX2__
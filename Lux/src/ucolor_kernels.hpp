@@ -0,0 +1,166 @@
+// SIMD kernels behind ucolor_batch.hpp - internal to ucolor_batch.cpp and ucolor_batch_avx2.cpp
+// Each instruction set supplies a struct of register operations, and the kernels are written once as templates over it.
+// Kernels handle whole registers only and return the number of pixels done; the caller finishes the rest one at a time.
+
+#ifndef __UCOLOR_KERNELS_HPP
+#define __UCOLOR_KERNELS_HPP
+
+#include "ucolor.hpp"
+#include <cstddef>
+
+struct batch_table {
+    size_t ( *blend )(        ucolor*, const ucolor*, const ucolor*, unsigned int, size_t );
+    size_t ( *blend_each )(   ucolor*, const ucolor*, const ucolor*, const unsigned int*, size_t );
+    size_t ( *addc )(         ucolor*, const ucolor*, size_t );
+    size_t ( *addc_single )(  ucolor*, const ucolor*, size_t );
+    size_t ( *subc )(         ucolor*, const ucolor*, size_t );
+    size_t ( *subc_single )(  ucolor*, const ucolor*, size_t );
+    size_t ( *mulc )(         ucolor*, const ucolor*, size_t );
+    size_t ( *mulc_single )(  ucolor*, const ucolor*, size_t );
+    size_t ( *manhattan )(    unsigned int*, const ucolor*, const ucolor*, size_t );
+    size_t ( *apply_mask )(   ucolor*, const ucolor*, const ucolor*, size_t );
+    size_t ( *rotate_color )( ucolor*, int, size_t );
+    size_t ( *invert )(       ucolor*, size_t );
+    size_t ( *sample_nearest )( ucolor*, const ucolor*, int, int, int, int, int, size_t );
+    size_t ( *pack_rgb )(     ucolor*, const unsigned char*, size_t );
+    size_t ( *unpack_rgb )(   unsigned char*, const ucolor*, size_t );
+};
+
+// null unless ucolor_batch_avx2.cpp was compiled for AVX2
+const batch_table* avx2_batch_table();
+
+template< class V > struct ucolor_kernels {
+    typedef typename V::reg reg;     // packed pixels
+    typedef typename V::reg16 reg16; // one channel per 16 bit lane, half as many pixels
+    static constexpr size_t w = V::width;
+
+    // alpha from a, color channels from c
+    static inline reg keep_alpha( reg a, reg c ) { return V::or_( V::and_( a, V::set1( 0xff000000 ) ), V::and_( c, V::set1( 0x00ffffff ) ) ); }
+
+    // second operand is either a run of pixels or a single color used for every pixel
+    template< bool single > static inline reg load2( const ucolor* c2, size_t i ) {
+        if constexpr( single ) return V::set1( *c2 );
+        else return V::load( c2 + i );
+    }
+
+    // a * prop + b * ( 256 - prop ) fits in 16 bits as long as prop <= 256
+    static size_t blend( ucolor* out, const ucolor* a, const ucolor* b, unsigned int prop, size_t n ) {
+        reg16 p = V::set16( prop ), ip = V::set16( 256 - prop );
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg va = V::load( a + i ), vb = V::load( b + i );
+            reg16 lo = V::template srli16< 8 >( V::add16( V::mul16( V::lo16( va ), p ), V::mul16( V::lo16( vb ), ip ) ) );
+            reg16 hi = V::template srli16< 8 >( V::add16( V::mul16( V::hi16( va ), p ), V::mul16( V::hi16( vb ), ip ) ) );
+            V::store( out + i, keep_alpha( va, V::pack16( lo, hi ) ) );
+        }
+        return i;
+    }
+
+    // as above with a proportion per pixel, spread over that pixel's four 16 bit channels
+    static size_t blend_each( ucolor* out, const ucolor* a, const ucolor* b, const unsigned int* prop, size_t n ) {
+        reg16 full = V::set16( 256 );
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg va = V::load( a + i ), vb = V::load( b + i ), p = V::load( prop + i );
+            p = V::or_( p, V::template slli32< 16 >( p ) );
+            reg16 plo = V::spread_lo16( p ), phi = V::spread_hi16( p );
+            reg16 lo = V::template srli16< 8 >( V::add16( V::mul16( V::lo16( va ), plo ), V::mul16( V::lo16( vb ), V::sub16( full, plo ) ) ) );
+            reg16 hi = V::template srli16< 8 >( V::add16( V::mul16( V::hi16( va ), phi ), V::mul16( V::hi16( vb ), V::sub16( full, phi ) ) ) );
+            V::store( out + i, keep_alpha( va, V::pack16( lo, hi ) ) );
+        }
+        return i;
+    }
+
+    template< bool single > static size_t addc( ucolor* c1, const ucolor* c2, size_t n ) {
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg a = V::load( c1 + i );
+            V::store( c1 + i, keep_alpha( a, V::adds8( a, load2< single >( c2, i ) ) ) );
+        }
+        return i;
+    }
+
+    template< bool single > static size_t subc( ucolor* c1, const ucolor* c2, size_t n ) {
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg a = V::load( c1 + i );
+            V::store( c1 + i, keep_alpha( a, V::subs8( a, load2< single >( c2, i ) ) ) );
+        }
+        return i;
+    }
+
+    template< bool single > static size_t mulc( ucolor* c1, const ucolor* c2, size_t n ) {
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg a = V::load( c1 + i ), b = load2< single >( c2, i );
+            reg16 lo = V::template srli16< 8 >( V::mul16( V::lo16( a ), V::lo16( b ) ) );
+            reg16 hi = V::template srli16< 8 >( V::mul16( V::hi16( a ), V::hi16( b ) ) );
+            V::store( c1 + i, keep_alpha( a, V::pack16( lo, hi ) ) );
+        }
+        return i;
+    }
+
+    static size_t manhattan( unsigned int* out, const ucolor* a, const ucolor* b, size_t n ) {
+        reg low = V::set1( 0x000000ff );
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg va = V::load( a + i ), vb = V::load( b + i );
+            reg d = V::and_( V::or_( V::subs8( va, vb ), V::subs8( vb, va ) ), V::set1( 0x00ffffff ) );
+            V::store( out + i, V::add32( V::add32( V::and_( d, low ), V::and_( V::template srli32< 8 >( d ), low ) ), V::template srli32< 16 >( d ) ) );
+        }
+        return i;
+    }
+
+    // MASK_BLEND - ( 255 - M ) * R + M * L fits in 16 bits
+    static size_t apply_mask( ucolor* result, const ucolor* layer, const ucolor* mask, size_t n ) {
+        reg16 full = V::set16( 0xff );
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg r = V::load( result + i ), l = V::load( layer + i ), m = V::load( mask + i );
+            reg16 mlo = V::lo16( m ), mhi = V::hi16( m );
+            reg16 lo = V::template srli16< 8 >( V::add16( V::mul16( V::lo16( r ), V::sub16( full, mlo ) ), V::mul16( V::lo16( l ), mlo ) ) );
+            reg16 hi = V::template srli16< 8 >( V::add16( V::mul16( V::hi16( r ), V::sub16( full, mhi ) ), V::mul16( V::hi16( l ), mhi ) ) );
+            V::store( result + i, keep_alpha( r, V::pack16( lo, hi ) ) );
+        }
+        return i;
+    }
+
+    static size_t rotate_color( ucolor* c, int r, size_t n ) {
+        int k = ( r % 3 + 3 ) % 3;
+        if( !k ) return n;
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) {
+            reg a = V::load( c + i );
+            reg rot;
+            if( k == 1 ) rot = V::or_( V::template srli32< 8 >( V::and_( a, V::set1( 0x00ffff00 ) ) ), V::template slli32< 16 >( V::and_( a, V::set1( 0x000000ff ) ) ) );
+            else         rot = V::or_( V::template slli32< 8 >( V::and_( a, V::set1( 0x0000ffff ) ) ), V::template srli32< 16 >( V::and_( a, V::set1( 0x00ff0000 ) ) ) );
+            V::store( c + i, keep_alpha( a, rot ) );
+        }
+        return i;
+    }
+
+    static size_t invert( ucolor* c, size_t n ) {
+        reg rgb = V::set1( 0x00ffffff );
+        size_t i = 0;
+        for( ; i + w <= n; i += w ) V::store( c + i, V::xor_( V::load( c + i ), rgb ) );
+        return i;
+    }
+
+    // needs a gather instruction, so only AVX2 replaces this
+    static size_t sample_nearest( ucolor*, const ucolor*, int, int, int, int, int, size_t ) { return 0; }
+
+    // need a byte shuffle, which SSE2 lacks, so only AVX2 and NEON replace these
+    static size_t pack_rgb(   ucolor*, const unsigned char*, size_t ) { return 0; }
+    static size_t unpack_rgb( unsigned char*, const ucolor*, size_t ) { return 0; }
+};
+
+template< class K > batch_table make_batch_table() {
+    return { K::blend, K::blend_each,
+             K::template addc< false >, K::template addc< true >,
+             K::template subc< false >, K::template subc< true >,
+             K::template mulc< false >, K::template mulc< true >,
+             K::manhattan, K::apply_mask, K::rotate_color, K::invert, K::sample_nearest,
+             K::pack_rgb, K::unpack_rgb };
+}
+
+#endif // __UCOLOR_KERNELS_HPP
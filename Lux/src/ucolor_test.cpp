@@ -0,0 +1,165 @@
+#include "ucolor_batch.hpp"
+#include "joy_rand.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <functional>
+
+// Checks every batch function against the single pixel functions for each instruction set this machine supports,
+// over run lengths that exercise the leftover pixels, then times each one.
+// Usage: ./ucolor_test [pixels] [repeats]
+
+std::vector< ucolor > random_pixels( size_t n ) {
+    std::vector< ucolor > v( n );
+    for( auto& c : v ) c = rand_uint( gen );
+    return v;
+}
+
+// runs one batch operation on copies of the inputs and compares with the reference
+template< class F, class G > bool check( const std::string& name, F batch, G reference, size_t n ) {
+    auto a = random_pixels( n ), b = random_pixels( n ), c = random_pixels( n );
+    auto a1 = a, a2 = a;
+    std::vector< unsigned int > o1( n ), o2( n );
+    batch(     a1.data(), b.data(), c.data(), o1.data(), n );
+    reference( a2.data(), b.data(), c.data(), o2.data(), n );
+    for( size_t i = 0; i < n; i++ ) {
+        if( a1[ i ] != a2[ i ] || o1[ i ] != o2[ i ] ) {
+            std::cout << "  " << name << " mismatch at " << i << " of " << n << std::hex
+                      << ": a " << a[ i ] << " b " << b[ i ] << " c " << c[ i ]
+                      << " -> " << a1[ i ] << " / " << o1[ i ] << " expected " << a2[ i ] << " / " << o2[ i ] << std::dec << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef std::function< void ( ucolor*, const ucolor*, const ucolor*, unsigned int*, size_t ) > batch_op;
+
+struct op {
+    std::string name;
+    batch_op batch, reference;
+};
+
+std::vector< op > ops() {
+    std::vector< op > v;
+    for( unsigned int prop : { 0u, 1u, 100u, 255u, 256u } ) {
+        v.push_back( { "blend " + std::to_string( prop ),
+            [ prop ]( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { blend_n( a, b, c, prop, n ); },
+            [ prop ]( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) a[ i ] = blend( b[ i ], c[ i ], prop ); } } );
+    }
+    // c taken as proportions 0-256
+    v.push_back( { "blend each",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) {
+            std::vector< unsigned int > p( c, c + n );
+            for( auto& x : p ) x %= 257;
+            blend_n( a, b, a, p.data(), n );
+        },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) a[ i ] = blend( b[ i ], a[ i ], c[ i ] % 257 ); } } );
+    v.push_back( { "addc",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { addc_n( a, b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) addc( a[ i ], b[ i ] ); } } );
+    v.push_back( { "addc single",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { if( n ) addc_n( a, *b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) addc( a[ i ], *b ); } } );
+    v.push_back( { "subc",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { subc_n( a, b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) subc( a[ i ], b[ i ] ); } } );
+    v.push_back( { "subc single",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { if( n ) subc_n( a, *b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) subc( a[ i ], *b ); } } );
+    v.push_back( { "mulc",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { mulc_n( a, b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) a[ i ] = mulc( a[ i ], b[ i ] ); } } );
+    v.push_back( { "mulc single",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { if( n ) mulc_n( a, *b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) a[ i ] = mulc( a[ i ], *b ); } } );
+    v.push_back( { "manhattan",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { manhattan_n( o, b, c, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) o[ i ] = manhattan( b[ i ], c[ i ] ); } } );
+    v.push_back( { "apply_mask",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { apply_mask_n( a, b, c, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) apply_mask( a[ i ], b[ i ], c[ i ] ); } } );
+    for( int r : { -1, 0, 1, 2, 4 } ) {
+        v.push_back( { "rotate_color " + std::to_string( r ),
+            [ r ]( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { rotate_color_n( a, r, n ); },
+            [ r ]( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) rotate_color( a[ i ], r ); } } );
+    }
+    v.push_back( { "invert",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { invert_n( a, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { for( size_t i = 0; i < n; i++ ) invert( a[ i ] ); } } );
+    // b read as rows of two pixels, x stepping backwards - every coordinate stays inside the run
+    v.push_back( { "sample_nearest",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { sample_nearest_n( a, b, 2, (int)( n / 4 ) << 16, 0x1234, -0x3000, 0x4000, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) {
+            for( size_t i = 0; i < n; i++ ) a[ i ] = b[ ( ( 0x1234 + (int)i * 0x4000 ) >> 16 ) * 2 + ( ( ( (int)( n / 4 ) << 16 ) - (int)i * 0x3000 ) >> 16 ) ];
+        } } );
+    // b read as three bytes per pixel, o written as three bytes per pixel
+    v.push_back( { "pack_rgb",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { pack_rgb_n( a, (const unsigned char*)b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) {
+            const unsigned char* rgb = (const unsigned char*)b;
+            for( size_t i = 0; i < n; i++ ) { a[ i ] = 0xff000000; setrc( a[ i ], rgb[ i * 3 ] ); setgc( a[ i ], rgb[ i * 3 + 1 ] ); setbc( a[ i ], rgb[ i * 3 + 2 ] ); }
+        } } );
+    v.push_back( { "unpack_rgb",
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) { unpack_rgb_n( (unsigned char*)o, b, n ); },
+        []( ucolor* a, const ucolor* b, const ucolor* c, unsigned int* o, size_t n ) {
+            unsigned char* rgb = (unsigned char*)o;
+            for( size_t i = 0; i < n; i++ ) { rgb[ i * 3 ] = rc( b[ i ] ); rgb[ i * 3 + 1 ] = gc( b[ i ] ); rgb[ i * 3 + 2 ] = bc( b[ i ] ); }
+        } } );
+    return v;
+}
+
+int main( int argc, char** argv ) {
+    size_t pixels = 1 << 20;
+    int repeats = 20;
+    if( argc > 1 ) std::stringstream( argv[ 1 ] ) >> pixels;
+    if( argc > 2 ) std::stringstream( argv[ 2 ] ) >> repeats;
+
+    // single pixel sanity checks
+    bool ok = true;
+    ok &= rotate_color( (ucolor)0xff123456, 1 ) == 0xff561234;
+    ok &= rotate_color( (ucolor)0xff123456, 2 ) == 0xff345612;
+    ok &= mulc( (ucolor)0x80ffffff, (ucolor)0xff804020 ) == 0x807f3f1f;
+    if( !ok ) std::cout << "single pixel functions give unexpected results" << std::endl;
+
+    std::vector< ucolor_isa > isas;
+    for( ucolor_isa isa : { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_NEON } ) {
+        set_isa( isa );
+        if( get_isa() == isa ) isas.push_back( isa );
+    }
+    std::cout << "best instruction set " << isa_name( best_isa() ) << std::endl;
+
+    auto all = ops();
+    for( auto isa : isas ) {
+        set_isa( isa );
+        int failed = 0;
+        for( auto& o : all ) {
+            for( size_t n = 0; n < 70; n++ ) if( !check( o.name, o.batch, o.reference, n ) ) { failed++; break; }
+            if( !check( o.name, o.batch, o.reference, 100003 ) ) failed++;
+        }
+        std::cout << std::left << std::setw( 8 ) << isa_name( isa ) << ( failed ? "FAILED" : "matches scalar" ) << std::endl;
+        if( failed ) ok = false;
+    }
+
+    // timing in ms per run of pixels
+    typedef std::chrono::steady_clock clock;
+    auto a = random_pixels( pixels ), b = random_pixels( pixels ), c = random_pixels( pixels );
+    std::vector< unsigned int > o( pixels );
+    std::cout << std::endl << pixels << " pixels" << std::endl << std::left << std::setw( 16 ) << "";
+    for( auto isa : isas ) std::cout << std::right << std::setw( 10 ) << isa_name( isa );
+    std::cout << std::endl;
+    for( auto& op : all ) {
+        std::cout << std::left << std::setw( 16 ) << op.name;
+        for( auto isa : isas ) {
+            set_isa( isa );
+            auto t0 = clock::now();
+            for( int i = 0; i < repeats; i++ ) op.batch( a.data(), b.data(), c.data(), o.data(), pixels );
+            auto t1 = clock::now();
+            std::cout << std::right << std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << std::chrono::duration< double, std::milli >( t1 - t0 ).count() / repeats;
+        }
+        std::cout << std::endl;
+    }
+    set_isa( best_isa() );
+    return ok ? 0 : 1;
+}
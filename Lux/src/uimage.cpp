@@ -1,83 +1,101 @@
 #include "uimage.hpp"
 #include <memory>
 #include "image_loader.hpp"
+#include "ucolor_batch.hpp"
+#include "thread_pool.hpp"
 
 
 // pixel modification functions
 template<> void uimage::grayscale() {
     for( auto& f : base ) { f = gray( f ); }
-    //mip_it();
+    mark_dirty();
 }
 
 template<> void uimage::invert() {
-    for( auto& c : base ) { ::invert( c ); }
-    //mip_it();
+    invert_n( base.data(), base.size() );
+    mark_dirty();
 }
 
 template<> void uimage::rotate_colors( const int& r ) {
-    for( auto& c : base ) { rotate_color( c, r ); }
-    //mip_it();
+    rotate_color_n( base.data(), r, base.size() );
+    mark_dirty();
 }
 
+template<> void uimage::apply_mask( const uimage& layer, const uimage& mask, const mask_mode& mmode ) {
+    apply_mask_n( base.data(), layer.base.data(), mask.base.data(), std::min( { base.size(), layer.base.size(), mask.base.size() } ), mmode );
+    mark_dirty();
+}
+
+template<> uimage& uimage::operator += ( uimage& rhs ) {
+    addc_n( base.data(), rhs.base.data(), std::min( base.size(), rhs.base.size() ) );
+    mark_dirty();
+    return *this;
+}
+
+template<> uimage& uimage::operator += ( const ucolor& rhs ) {
+    addc_n( base.data(), rhs, base.size() );
+    mark_dirty();
+    return *this;
+}
+
+template<> uimage& uimage::operator -= ( uimage& rhs ) {
+    subc_n( base.data(), rhs.base.data(), std::min( base.size(), rhs.base.size() ) );
+    mark_dirty();
+    return *this;
+}
+
+template<> uimage& uimage::operator -= ( const ucolor& rhs ) {
+    subc_n( base.data(), rhs, base.size() );
+    mark_dirty();
+    return *this;
+}
+
+template<> uimage& uimage::operator *= ( uimage& rhs ) {
+    mulc_n( base.data(), rhs.base.data(), std::min( base.size(), rhs.base.size() ) );
+    mark_dirty();
+    return *this;
+}
+
+template<> uimage& uimage::operator *= ( const ucolor& rhs ) {
+    mulc_n( base.data(), rhs, base.size() );
+    mark_dirty();
+    return *this;
+}
+
+// Rows are converted in parallel, three channel rows through the batch packer. Alpha is opaque unless the file has it
+// Grey images set every color channel, and the alpha of grey + alpha images is dropped
 template<> void uimage::load( const std::string& filename ) {
-    base.clear();
     image_loader loader( filename );
     dim = { loader.xsiz, loader.ysiz };
     refresh_bounds();
-    //std::cout << "uimage::load: " << filename << " " << loader.xsiz << " " << loader.ysiz << " " << loader.channels << std::endl;
-    ucolor f = 0xff000000;
-
-//    int size = loader.xsiz * loader.ysiz;
-//    auto it = std::begin( loader.img );
-    for (auto it = std::begin( loader.img ); it < std::end( loader.img ); ) {
- //   for( int i = 0; i < size; i++ ) {
-        if( loader.channels == 1 )	// monochrome image
-        {
-            setrc( f, *it );
-            setgc( f, *it );
-            setbc( f, *it );
-            it++;
+    base.resize( (size_t)dim.x * dim.y );
+    const unsigned char* in = loader.img.data();
+    int channels = loader.channels;
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        ucolor* out = base.data();
+        switch( channels ) {
+            case 3: pack_rgb_n( out + i0, in + i0 * 3, i1 - i0 ); break;
+            case 4:
+                for( size_t i = i0; i < i1; i++ ) 
+                    out[ i ] = ( (ucolor)in[ i * 4 + 3 ] << 24 ) | ( (ucolor)in[ i * 4 + 2 ] << 16 ) | ( (ucolor)in[ i * 4 + 1 ] << 8 ) | in[ i * 4 ];
+                break;
+            default:
+                for( size_t i = i0; i < i1; i++ ) {
+                    ucolor v = in[ i * channels ];
+                    out[ i ] = 0xff000000 | ( v << 16 ) | ( v << 8 ) | v;
+                }
         }
-
-        if( loader.channels == 2 ) // don't know what to do in this case
-        {
-            setrc( f, *it );
-            setgc( f, *it );
-            setbc( f, *it );
-            it++; it++;
-        }
-
-        if( loader.channels == 4 ) 
-        {
-            setac( f, *it );
-            it++;
-        }	
-
-        if( ( loader.channels == 3 ) | ( loader.channels == 4 ) )
-        {
-            setrc( f, *it );
-            it++;
-            setgc( f, *it );
-            it++;
-            setbc( f, *it );
-            it++;
-        }
-
-        // skip alpha channel - rgba ... if argb need to move line up
-        base.push_back( f );
-    }
-    //mip_it();
+    } );
+    mark_dirty();
 }
 
 template<> void uimage::write_jpg( const std::string& filename, int quality ) {
-    //std::cout << "uimage::write_jpg: " << filename << std::endl;
-    //dump();
-    std::vector< unsigned char > carray;
-    for( auto& f : base ) {
-        carray.push_back( rc( f ) );
-        carray.push_back( gc( f ) );
-        carray.push_back( bc( f ) ); 
-    }
+    std::vector< unsigned char > carray( (size_t)dim.x * dim.y * 3 );
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        size_t i0 = (size_t)y0 * dim.x, i1 = (size_t)y1 * dim.x;
+        unpack_rgb_n( carray.data() + i0 * 3, base.data() + i0, i1 - i0 );
+    } );
 	wrapped_write_jpg( filename.c_str(), dim.x, dim.y, 3, carray.data(), quality );
 }
 
@@ -88,18 +106,20 @@ template<> void uimage::write_png( const std::string& filename ) {
 // Fixed point version of sample
 
 template<> const ucolor image< ucolor >::sample ( const unsigned int mip_level, const unsigned int mip_blend, const vec2i& vi ) const  {
+    const ucolor* lower = mip_data( mip_level );
+    const ucolor* upper = mip_data( mip_level + 1 );
     int l_index = ( vi.x >> ( 16 + mip_level     ) ) + ( vi.y >> ( 16 + mip_level     ) ) * mip_dim[ mip_level     ].x;
     int u_index = ( vi.x >> ( 16 + mip_level + 1 ) ) + ( vi.y >> ( 16 + mip_level + 1 ) ) * mip_dim[ mip_level + 1 ].x;
 
     return  blend(
                 blend(
-                    blend( mip[ mip_level ][ l_index ], mip[ mip_level ][ l_index + 1 ],( vi.x >> ( 8 + mip_level ) ) & 0xff ),
-                    blend( mip[ mip_level ][ l_index + mip_dim[ mip_level ].x ], mip[ mip_level ][ l_index + mip_dim[ mip_level ].x + 1 ],( vi.x >> ( 8 + mip_level ) ) & 0xff ),
+                    blend( lower[ l_index ], lower[ l_index + 1 ],( vi.x >> ( 8 + mip_level ) ) & 0xff ),
+                    blend( lower[ l_index + mip_dim[ mip_level ].x ], lower[ l_index + mip_dim[ mip_level ].x + 1 ],( vi.x >> ( 8 + mip_level ) ) & 0xff ),
                     ( vi.y >> ( 8 + mip_level ) ) & 0xff 
                 ),
                 blend(
-                    blend( mip[ mip_level + 1 ][ u_index ], mip[ mip_level + 1 ][ u_index + 1 ],( vi.x >> ( 8 + mip_level + 1 ) ) & 0xff ),
-                    blend( mip[ mip_level ][ u_index + mip_dim[ mip_level + 1 ].x ], mip[ mip_level ][ u_index + mip_dim[ mip_level + 1 ].x + 1 ],( vi.x >> ( 8 + mip_level + 1 ) ) & 0xff ),
+                    blend( upper[ u_index ], upper[ u_index + 1 ],( vi.x >> ( 8 + mip_level + 1 ) ) & 0xff ),
+                    blend( upper[ u_index + mip_dim[ mip_level + 1 ].x ], upper[ u_index + mip_dim[ mip_level + 1 ].x + 1 ],( vi.x >> ( 8 + mip_level + 1 ) ) & 0xff ),
                     ( vi.y >> ( 8 + mip_level + 1 ) ) & 0xff 
                 ),
                 mip_blend >> 8
@@ -10,6 +10,15 @@
 template<> void uimage::grayscale();
 template<> void uimage::rotate_colors( const int& r );
 template<> void uimage::invert();
+template<> void uimage::apply_mask( const uimage& layer, const uimage& mask, const mask_mode& mmode );
+
+// channel arithmetic using batch functions - saturates each channel and keeps alpha of this image
+template<> uimage& uimage::operator += ( uimage& rhs );
+template<> uimage& uimage::operator += ( const ucolor& rhs );
+template<> uimage& uimage::operator -= ( uimage& rhs );
+template<> uimage& uimage::operator -= ( const ucolor& rhs );
+template<> uimage& uimage::operator *= ( uimage& rhs );
+template<> uimage& uimage::operator *= ( const ucolor& rhs );
 
 // I/O functions using template specialization
 template<> void uimage::load( const std::string& filename );
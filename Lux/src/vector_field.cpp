@@ -1,6 +1,10 @@
 #include "linalg.h"
 #include "vect2.hpp"
 #include "vector_field.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
 
 vec2f vortex::operator () ( const vec2f& v, const float& t ) {
     vec2f center = center_orig;
@@ -77,6 +81,20 @@ void vortex_field::generate() {
     }
 }
 
+float vortex_field::period() const {
+    int g = 0;
+    for( auto& vort : vorts ) if( vort.revolving ) g = std::gcd( g, vort.velocity );
+    return g ? 1.0f / g : 0.0f;
+}
+
+bool vortex_field::same_parameters( const vortex_field& f ) const {
+    return n == f.n && bounds.b1 == f.bounds.b1 && bounds.b2 == f.bounds.b2 && scale_factor == f.scale_factor &&
+        min_diameter == f.min_diameter && max_diameter == f.max_diameter && min_soften == f.min_soften && max_soften == f.max_soften &&
+        min_intensity == f.min_intensity && max_intensity == f.max_intensity && intensity_direction == f.intensity_direction &&
+        revolving == f.revolving && min_velocity == f.min_velocity && max_velocity == f.max_velocity && velocity_direction == f.velocity_direction &&
+        min_orbital_radius == f.min_orbital_radius && max_orbital_radius == f.max_orbital_radius;
+}
+
 // Use Newton's method to move along flow line proportional to step value
 // Angle in degrees
 vec2f vf_tools::advect( const vec2f& v, const float& step, const float& angle, const bool& smooth, const image_extend& extend ) const
@@ -91,89 +109,222 @@ vec2f vf_tools::advect( const vec2f& v, const float& step, const mat2f& m, const
     return v + linalg::mul( m, img.sample( v, smooth, extend ) ) * step;
 }
 
-void vf_tools::complement() { for( auto& v : img.base ) { v = ::complement( v ); } //img.mip_it(); 
-}
-void vf_tools::radial()     { for( auto& v : img.base ) { v = ::radial( v );     } //img.mip_it(); 
-}
-void vf_tools::cartesian()  { for( auto& v : img.base ) { v = ::cartesian( v );  } //img.mip_it(); 
-}
+void vf_tools::complement() { for( auto& v : img.base ) { v = ::complement( v ); } img.mark_dirty(); }
+void vf_tools::radial()     { for( auto& v : img.base ) { v = ::radial( v );     } img.mark_dirty(); }
+void vf_tools::cartesian()  { for( auto& v : img.base ) { v = ::cartesian( v );  } img.mark_dirty(); }
 
 void vf_tools::rotate_vectors( const float& ang ) {
     mat2f m = linalg::rotation_matrix_2D( ang / 360.0f * TAU );
     for( auto& v : img.base ) { v = linalg::mul( m, v ); }
-    //img.mip_it();
+    img.mark_dirty();
+}
+
+// Generators below run rows in parallel, each row written in one pass over flat float runs so the inner loops vectorize
+
+// Runs fn( row, y ) for every row of the field, rows split across the pool
+template< class F > static void each_row( vec2f* base, const vec2i& dim, F fn ) {
+    int w = dim.x;
+    global_pool().parallel_for( dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        for( int y = y0; y < y1; y++ ) fn( base + (size_t)y * w, y );
+    } );
+}
+
+// Field coordinate of each column, and of a row - the two halves of bounds.bb_map( { x, y }, ipbounds )
+static std::vector< float > column_positions( int w, const bb2f& bounds, const bb2i& ipbounds ) {
+    std::vector< float > xs( w );
+    for( int x = 0; x < (int)xs.size(); x++ ) xs[ x ] = bounds.bb_map( vec2f( x, 0 ), ipbounds ).x;
+    return xs;
+}
+
+static float row_position( int y, const bb2f& bounds, const bb2i& ipbounds ) { return bounds.bb_map( vec2f( 0, y ), ipbounds ).y; }
+
+static vec2f vortex_center( const ::vortex& vort, const float& t ) {
+    if( vort.revolving ) return vort.center_of_revolution + linalg::rot( vort.velocity * t * TAU, vort.center_orig - vort.center_of_revolution );
+    return vort.center_orig;
 }
 
 void vf_tools::normalize() { 
-    std::transform( img.base.begin(), img.base.end(), img.base.begin(), [] ( const vec2f& v ) { return linalg::normalize( v );  } ); 
-    //img.mip_it();
+    each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) { for( int x = 0; x < img.dim.x; x++ ) row[ x ] = linalg::normalize( row[ x ] ); } );
+    img.mark_dirty();
 }
 
+// Same result as ::inverse() and ::inverse_square() at each pixel
+// With softening there is no zero vector case, so that loop has no branches and vectorizes
 void vf_tools::inverse( float diameter, float soften ) {
     if( diameter == 0.0f ) { img.fill( { 0.0f, 0.0f } ); }
-    else for( auto& v : img.base ) { v = ::inverse( v, diameter, soften ); }
-    //img.mip_it();
+    else if( soften == 0.0f ) each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) { for( int x = 0; x < img.dim.x; x++ ) row[ x ] = ::inverse( row[ x ], diameter ); } );
+    else each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) {
+        float* v = (float*)row;
+        for( int x = 0; x < img.dim.x; x++ ) {
+            float vx = v[ x * 2 ], vy = v[ x * 2 + 1 ];
+            float s = ( vx * vx + vy * vy ) / diameter + soften;
+            v[ x * 2 ]     = vx / s;
+            v[ x * 2 + 1 ] = vy / s;
+        }
+    } );
+    img.mark_dirty();
 }
 
 void vf_tools::inverse_square( float diameter, float soften ) {
     if( diameter == 0.0f ) { img.fill( { 0.0f, 0.0f } ); }
-    else for( auto& v : img.base ) { v = ::inverse_square( v, diameter, soften ); }
-    //img.mip_it();
+    else each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) { for( int x = 0; x < img.dim.x; x++ ) row[ x ] = ::inverse_square( row[ x ], diameter, soften ); } );
+    img.mark_dirty();
 }
 
 void vf_tools::concentric( const vec2f& center ) { 
-    position_fill();
-    for( auto& v : img.base ) { v = v - center; }
-    //img.mip_it(); 
+    auto xs = column_positions( img.dim.x, img.bounds, img.ipbounds );
+    each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) {
+        float* v = (float*)row;
+        float py = row_position( y, img.bounds, img.ipbounds ) - center.y;
+        for( int x = 0; x < img.dim.x; x++ ) { v[ x * 2 ] = xs[ x ] - center.x; v[ x * 2 + 1 ] = py; }
+    } );
+    img.mark_dirty();
 }
 
+// concentric() turned a quarter turn
 void vf_tools::rotation( const vec2f& center ) { 
-    concentric();
-    complement();
+    auto xs = column_positions( img.dim.x, img.bounds, img.ipbounds );
+    each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) {
+        float* v = (float*)row;
+        float py = row_position( y, img.bounds, img.ipbounds ) - center.y;
+        for( int x = 0; x < img.dim.x; x++ ) { v[ x * 2 ] = -py; v[ x * 2 + 1 ] = xs[ x ] - center.x; }
+    } );
+    img.mark_dirty();
 }
 
+// concentric * cscale + rotation * rscale, in one pass
 void vf_tools::spiral( const vec2f& center, const float& cscale, const float& rscale )
 {
-    vector_field buffer( img );
-    vf_tools buffer_tools( buffer );
-
-    concentric();
-    img *= cscale;
-    buffer_tools.rotation();
-    buffer *= rscale;
-    img += buffer;
-    //img.mip_it();
+    auto xs = column_positions( img.dim.x, img.bounds, img.ipbounds );
+    each_row( img.base.data(), img.dim, [ & ]( vec2f* row, int y ) {
+        float* v = (float*)row;
+        float py = row_position( y, img.bounds, img.ipbounds ) - center.y;
+        for( int x = 0; x < img.dim.x; x++ ) {
+            float px = xs[ x ] - center.x;
+            v[ x * 2 ]     = px * cscale + -py * rscale;
+            v[ x * 2 + 1 ] = py * cscale +  px * rscale;
+        }
+    } );
+    img.mark_dirty();
 }
 
+// Sums each vortex into a row of separate x and y accumulators, a vortex at a time, so the work per vortex is a
+// straight run of floats. Gives the same sum, in the same order, as adding single vortex fields together
+struct vortex_batch {
+    std::vector< float > cx, cy, diameter, soften, intensity;
+
+    vortex_batch( const std::vector< vortex >& vorts, const float& t ) {
+        for( auto& vort : vorts ) {
+            if( vort.diameter == 0.0f ) continue;   // a zero field, as in vf_tools::inverse()
+            vec2f c = vortex_center( vort, t );
+            cx.push_back( c.x );  cy.push_back( c.y );
+            diameter.push_back( vort.diameter );  soften.push_back( vort.soften );  intensity.push_back( vort.intensity );
+        }
+    }
+
+    void add_row( float* ax, float* ay, const float* xs, float py, int w ) const {
+        for( size_t k = 0; k < cx.size(); k++ ) {
+            float dy = py - cy[ k ], d = diameter[ k ], s0 = soften[ k ], in = intensity[ k ], c = cx[ k ];
+            if( dy == 0.0f && s0 == 0.0f ) {
+                // row through an unsoftened center - zero at the center, as in inverse()
+                for( int x = 0; x < w; x++ ) {
+                    float dx = xs[ x ] - c;
+                    if( dx == 0.0f ) continue;
+                    float s = ( dy * dy + dx * dx ) / d + s0;
+                    ax[ x ] += -dy / s * in;
+                    ay[ x ] +=  dx / s * in;
+                }
+            }
+            else for( int x = 0; x < w; x++ ) {
+                float dx = xs[ x ] - c;
+                float s = ( dy * dy + dx * dx ) / d + s0;
+                ax[ x ] += -dy / s * in;
+                ay[ x ] +=  dx / s * in;
+            }
+        }
+    }
+};
+
+// Rotation field about the vortex center, through inverse() and scaled by intensity
 void vf_tools::vortex( const ::vortex& vort, const float& t ) {
-    vec2f center= vort.center_orig;
-    if( vort.revolving ) center = vort.center_of_revolution + linalg::rot( vort.velocity * t * TAU, vort.center_orig - vort.center_of_revolution );
-    rotation( center );
-    inverse( vort.diameter, vort.soften );
-    img *= vort.intensity;
-    //img.mip_it();
+    turbulent( std::vector< ::vortex >( 1, vort ), t );
 }
 
 void vf_tools::turbulent( vortex_field& ca, const float& t ) {
     //if( !(ca.generated) ) ca.generate();
-    img.fill( { 0.0f, 0.0f } );
-    vector_field buffer( img );
-    vf_tools buffer_tools( buffer );
+    turbulent( ca.vorts, t );
+}
 
+void vf_tools::turbulent( const std::vector< ::vortex >& vorts, const float& t ) {
+    vortex_batch batch( vorts, t );
+    auto xs = column_positions( img.dim.x, img.bounds, img.ipbounds );
+    int w = img.dim.x;
     // cavort cavort cavort
-    for( auto& vort : ca.vorts ) { buffer_tools.vortex( vort ); img += buffer; }
-    //img.mip_it();
+    global_pool().parallel_for( img.dim.y, global_pool().size(), [ & ]( int y0, int y1, int ) {
+        std::vector< float > ax( w ), ay( w );
+        for( int y = y0; y < y1; y++ ) {
+            std::fill( ax.begin(), ax.end(), 0.0f );
+            std::fill( ay.begin(), ay.end(), 0.0f );
+            batch.add_row( ax.data(), ay.data(), xs.data(), row_position( y, img.bounds, img.ipbounds ), w );
+            float* v = (float*)( img.base.data() + (size_t)y * w );
+            for( int x = 0; x < w; x++ ) { v[ x * 2 ] = ax[ x ]; v[ x * 2 + 1 ] = ay[ x ]; }
+        }
+    } );
+    img.mark_dirty();
 }
  
 void vf_tools::position_fill() { 
-    auto v = img.base.begin();
-    for( int y = 0; y < img.dim.y; y++ ) {
-        for( int x = 0; x < img.dim.x; x++ ) {
-            *v = img.bounds.bb_map( vec2f( x, y ), img.ipbounds );
-            v++;
+    concentric( { 0.0f, 0.0f } );
+    // rather than using //mip_it() here, calculate directly up hierarchy using bounding box
+}
+
+// f must already be generated
+void turbulent_cache::render( vector_field& img, vortex_field& f, const float& t, const float& time_interval ) {
+    float p = f.period();
+    int n = 1;      // a field that doesn't move has one phase
+    if( p > 0.0f ) {
+        if( phases > 0 ) n = phases;
+        else {
+            float frames = time_interval > 0.0f ? p / time_interval : 0.0f;
+            n = (int)std::lround( frames );
+            if( n < 1 || std::abs( frames - n ) > 0.001f ) { vf_tools( img ).turbulent( f, t ); return; }
         }
     }
-    // rather than using //mip_it() here, calculate directly up hierarchy using bounding box
+    if( img.get_dim() != dim || !( img.get_bounds().b1 == bounds.b1 && img.get_bounds().b2 == bounds.b2 ) || fields.size() != (size_t)n ) {
+        clear();
+        dim = img.get_dim();
+        bounds = img.get_bounds();
+        fields.resize( n );
+    }
+
+    // nearest phase - scene time is a running sum, so a frame in a later loop is a little off the first
+    float loops = p > 0.0f ? t / p : 0.0f;
+    int phase = (int)std::lround( ( loops - std::floor( loops ) ) * n ) % n;
+    float tp = phase * p / n;
+    auto& field = fields[ phase ];
+    if( !field ) {
+        size_t field_bytes = (size_t)dim.x * dim.y * sizeof( vec2f );
+        if( bytes + field_bytes > max_bytes ) { vf_tools( img ).turbulent( f, tp ); return; }
+        field = std::make_unique< vector_field >( dim, bounds );
+        vf_tools( *field ).turbulent( f, tp );
+        bytes += field_bytes;
+    }
+    img.copy( *field );
+}
+
+void turbulent_cache::set_phases( int p ) {
+    if( p != phases ) clear();
+    phases = p;
+}
+
+void turbulent_cache::set_max_bytes( size_t m ) {
+    if( bytes > m ) clear();
+    max_bytes = m;
+}
+
+void turbulent_cache::clear() {
+    fields.clear();
+    bytes = 0;
 }
 
 /*
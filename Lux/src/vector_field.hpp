@@ -54,6 +54,8 @@ struct vortex_field  {                  // parameters for field of vortices
     bool generated;                     // has this.generate() been run?
  
     void generate();
+    float period() const;   // time for the animation to loop - 1 / gcd of the velocities, 0 if nothing moves
+    bool same_parameters( const vortex_field& f ) const;    // would generate() make the same kind of field?
 
     vec2f operator () ( const vec2f& v, const float& t = 0.0f );
 
@@ -73,7 +75,7 @@ struct vortex_field  {                  // parameters for field of vortices
             min_soften( min_soften_init ), max_soften( max_soften_init ),
             min_intensity( min_intensity_init ), max_intensity( max_intensity_init ), 
             intensity_direction( intensity_direction_init ),
-             min_velocity( 1 ), max_velocity( 1 ), velocity_direction( RANDOM ),
+            min_velocity( min_velocity_init ), max_velocity( max_velocity_init ), velocity_direction( velocity_direction_init ),
             min_orbital_radius( min_orbital_radius_init ), max_orbital_radius( max_orbital_radius_init ), 
             generated( false )  {}  
 };
@@ -109,6 +111,7 @@ public:
 
     void vortex( const ::vortex& vort, const float& t = 0.0f );
     void turbulent( vortex_field& f,  const float& t = 0.0f );
+    void turbulent( const std::vector< ::vortex >& vorts, const float& t = 0.0f );  // sum of vortex() fields
 
     void position_fill();
 
@@ -117,4 +120,26 @@ public:
     void visualize( image< ucolor >& img ) const {}
 };
 
+// Fields of an animated vortex_field kept for each phase of its loop, so later loops copy a field instead of summing
+// every vortex at every pixel. With phases set, time is rounded to that many steps per loop. Otherwise the steps are
+// the frames, found from the time interval - if the loop isn't a whole number of frames nothing is cached.
+// Fields past max_bytes are computed each time they're needed. Call clear() when the vortices change.
+class turbulent_cache {
+    std::vector< std::unique_ptr< vector_field > > fields;   // one per phase, null until first needed
+    int phases;
+    size_t max_bytes;
+    size_t bytes;
+    vec2i dim;
+    bb2f bounds;
+
+public:
+    turbulent_cache( int phases_init = 0, size_t max_bytes_init = 256 << 20 ) : phases( phases_init ), max_bytes( max_bytes_init ), bytes( 0 ) {}
+
+    void render( vector_field& img, vortex_field& f, const float& t, const float& time_interval );
+    void set_phases( int p );
+    void set_max_bytes( size_t m );
+    void clear();
+    size_t get_bytes() const { return bytes; }
+};
+
 #endif // __VECTOR_FIELD_HPP
@@ -0,0 +1,63 @@
+#include "uimage.hpp"
+#include "fimage.hpp"
+#include "joy_rand.hpp"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+
+// Times each image::warp() overload for every extend mode, nearest and smooth, the way eff_vector_warp
+// and eff_feedback use them - target and source the same size, vector field filled with small random offsets.
+// Usage: ./warp_bench [size] [repeats]
+
+template< class T > T random_pixel();
+template<> ucolor random_pixel() { return rand_uint( gen ); }
+template<> frgb   random_pixel() { return frgb( rand1( gen ), rand1( gen ), rand1( gen ) ); }
+
+template< class T > void bench( const std::string& name, int size, int repeats ) {
+    typedef std::chrono::steady_clock clock;
+    image< T > in( vec2i( size, size ) ), out( vec2i( size, size ) );
+    for( auto& p : in ) p = random_pixel< T >();
+    image< vec2f > vf( vec2i( size, size ) );
+    for( auto& v : vf ) v = { ( rand1( gen ) - 0.5f ) * 0.05f, ( rand1( gen ) - 0.5f ) * 0.05f };
+    image< int > wf( vec2i( size, size ) );
+    for( auto& w : wf ) w = rand_uint( gen ) % ( size * size );
+    image< vec2i > of( vec2i( size, size ) );
+    for( auto& o : of ) o = { (int)( rand_uint( gen ) % 21 ) - 10, (int)( rand_uint( gen ) % 21 ) - 10 };
+    auto swirl = []( vec2f v ) { return vec2f( -v.y, v.x ) * 0.02f; };
+    std::function< vec2f( vec2f ) > swirl_fn = swirl;
+
+    auto time = [ & ]( auto fn ) {
+        auto t0 = clock::now();
+        for( int r = 0; r < repeats; r++ ) fn();
+        auto t1 = clock::now();
+        std::cout << std::setw( 12 ) << std::setprecision( 3 ) << std::fixed << std::chrono::duration< double, std::milli >( t1 - t0 ).count() / repeats;
+    };
+
+    std::cout << name << " " << size << "x" << size << " - ms per warp" << std::endl;
+    std::cout << std::right << std::setw( 20 ) << "" << std::setw( 12 ) << "single" << std::setw( 12 ) << "repeat" << std::setw( 12 ) << "reflect" << std::endl;
+    for( bool smooth : { false, true } ) {
+        std::string s = smooth ? " smooth" : "";
+        std::cout << std::left << std::setw( 20 ) << "vector field" + s << std::right;
+        for( auto e : { SAMP_SINGLE, SAMP_REPEAT, SAMP_REFLECT } ) time( [ & ] { out.warp( in, vf, 1.0f, smooth, true, e ); } );
+        std::cout << std::endl << std::left << std::setw( 20 ) << "std::function" + s << std::right;
+        for( auto e : { SAMP_SINGLE, SAMP_REPEAT, SAMP_REFLECT } ) time( [ & ] { out.warp( in, swirl_fn, 1.0f, smooth, true, e ); } );
+        std::cout << std::endl << std::left << std::setw( 20 ) << "lambda" + s << std::right;
+        for( auto e : { SAMP_SINGLE, SAMP_REPEAT, SAMP_REFLECT } ) time( [ & ] { out.warp( in, swirl, 1.0f, smooth, true, e ); } );
+        std::cout << std::endl;
+    }
+    std::cout << std::left << std::setw( 20 ) << "offset field" << std::right;
+    for( auto e : { SAMP_SINGLE, SAMP_REPEAT, SAMP_REFLECT } ) time( [ & ] { out.warp( in, of, vec2i( 0, 0 ), e ); } );
+    std::cout << std::endl << std::left << std::setw( 20 ) << "warp field" << std::right;
+    time( [ & ] { out.warp( in, wf ); } );
+    std::cout << std::endl << std::endl;
+}
+
+int main( int argc, char** argv ) {
+    int size = 1024, repeats = 5;
+    if( argc > 1 ) std::stringstream( argv[ 1 ] ) >> size;
+    if( argc > 2 ) std::stringstream( argv[ 2 ] ) >> repeats;
+    bench< ucolor >( "ucolor", size, repeats );
+    bench< frgb >( "frgb", size, repeats );
+    return 0;
+}
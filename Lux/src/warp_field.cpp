@@ -31,4 +31,5 @@ template<> void warp_field::fill( const image< vec2f >& vfield, bool relative, c
             }
         }
     }
+    mark_dirty();
 }